@@ -0,0 +1,85 @@
+#include "coro/async_condition_variable.h"
+
+#include "coro/interrupted_exception.h"
+
+namespace coro {
+
+AsyncConditionVariable::WaitTask AsyncConditionVariable::Wait(
+    UniqueLock& lock, stdx::stop_token stop_token) {
+  return WaitTask(this, lock.mutex(), std::move(stop_token));
+}
+
+void AsyncConditionVariable::NotifyOne() {
+  if (WaitTask* waiter = waiters_.PopFront()) {
+    waiter->Relock();
+  }
+}
+
+void AsyncConditionVariable::NotifyAll() {
+  util::IntrusiveList<WaitTask> waiters;
+  waiters.Splice(waiters_);
+  while (WaitTask* waiter = waiters.PopFront()) {
+    waiter->Relock();
+  }
+}
+
+AsyncConditionVariable::WaitTask::WaitTask(
+    AsyncConditionVariable* condition_variable, Mutex* mutex,
+    stdx::stop_token stop_token)
+    : condition_variable_(condition_variable),
+      mutex_(mutex),
+      stop_callback_(std::move(stop_token), OnCancel{this}) {}
+
+AsyncConditionVariable::WaitTask::~WaitTask() {
+  if (condition_variable_->waiters_.Contains(this)) {
+    condition_variable_->waiters_.Remove(this);
+  }
+  if (relock_.linked()) {
+    mutex_->queued_.Remove(&relock_);
+  }
+}
+
+void AsyncConditionVariable::WaitTask::await_suspend(
+    stdx::coroutine_handle<void> handle) {
+  relock_.handle = handle;
+  // The waiter is queued before the mutex gets released, so a notification
+  // sent by the next lock holder can't be missed.
+  condition_variable_->waiters_.PushBack(this);
+  mutex_->Unlock();
+}
+
+void AsyncConditionVariable::WaitTask::await_resume() const {
+  if (interrupted_) {
+    throw InterruptedException();
+  }
+}
+
+Expected<void> AsyncConditionVariable::WaitTask::await_resume_expected()
+    const {
+  if (interrupted_) {
+    return Unexpected::Interrupted();
+  }
+  return {};
+}
+
+void AsyncConditionVariable::WaitTask::Relock() {
+  if (mutex_->LockOrQueue(&relock_)) {
+    relock_.handle.resume();
+  }
+}
+
+void AsyncConditionVariable::WaitTask::OnCancel::operator()() const {
+  if (!task->relock_.handle) {
+    // Not awaited yet, the mutex is still held.
+    task->interrupted_ = true;
+    return;
+  }
+  // Once notified, the waiter just waits for the mutex.
+  if (task->condition_variable_->waiters_.Contains(task)) {
+    task->condition_variable_->waiters_.Remove(task);
+    task->interrupted_ = true;
+    task->Relock();
+  }
+}
+
+}  // namespace coro
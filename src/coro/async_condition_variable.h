@@ -0,0 +1,88 @@
+#ifndef CORO_ASYNC_CONDITION_VARIABLE_H
+#define CORO_ASYNC_CONDITION_VARIABLE_H
+
+#include <utility>
+
+#include "coro/expected.h"
+#include "coro/mutex.h"
+#include "coro/stdx/coroutine.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+#include "coro/util/intrusive_list.h"
+
+namespace coro {
+
+// Condition variable for coroutines holding a coro::Mutex. Waiting is
+// allocation free, a notified waiter moves straight over to the mutex's queue.
+class AsyncConditionVariable {
+ public:
+  class WaitTask;
+
+  AsyncConditionVariable() = default;
+  AsyncConditionVariable(const AsyncConditionVariable&) = delete;
+  AsyncConditionVariable(AsyncConditionVariable&&) = delete;
+  AsyncConditionVariable& operator=(const AsyncConditionVariable&) = delete;
+  AsyncConditionVariable& operator=(AsyncConditionVariable&&) = delete;
+
+  // Releases `lock` and waits for a notification. The lock is reacquired
+  // before returning, also when InterruptedException gets thrown because
+  // `stop_token` got stopped.
+  WaitTask Wait(UniqueLock& lock,
+                stdx::stop_token stop_token = stdx::stop_token());
+
+  template <typename Predicate>
+  Task<> Wait(UniqueLock& lock, Predicate predicate,
+              stdx::stop_token stop_token = stdx::stop_token()) {
+    while (!predicate()) {
+      co_await Wait(lock, stop_token);
+    }
+  }
+
+  void NotifyOne();
+  void NotifyAll();
+
+  size_t waiter_count() const { return waiters_.size(); }
+
+ private:
+  util::IntrusiveList<WaitTask> waiters_;
+};
+
+class AsyncConditionVariable::WaitTask
+    : public util::IntrusiveListNode<WaitTask> {
+ public:
+  WaitTask(AsyncConditionVariable* condition_variable, Mutex* mutex,
+           stdx::stop_token stop_token);
+  ~WaitTask();
+
+  WaitTask(const WaitTask&) = delete;
+  WaitTask(WaitTask&&) = delete;
+  WaitTask& operator=(const WaitTask&) = delete;
+  WaitTask& operator=(WaitTask&&) = delete;
+
+  bool await_ready() const { return interrupted_; }
+  void await_suspend(stdx::coroutine_handle<void> handle);
+  void await_resume() const;
+  Expected<void> await_resume_expected() const;
+
+ private:
+  friend class AsyncConditionVariable;
+
+  struct OnCancel {
+    void operator()() const;
+    WaitTask* task;
+  };
+
+  // Resumes the awaiting coroutine once it got the mutex back.
+  void Relock();
+
+  AsyncConditionVariable* condition_variable_;
+  Mutex* mutex_;
+  Mutex::Waiter relock_;
+  bool interrupted_ = false;
+  stdx::stop_callback<OnCancel> stop_callback_;
+};
+
+}  // namespace coro
+
+#endif  // CORO_ASYNC_CONDITION_VARIABLE_H
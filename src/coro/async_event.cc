@@ -0,0 +1,87 @@
+#include "coro/async_event.h"
+
+#include <utility>
+
+#include "coro/interrupted_exception.h"
+
+namespace coro {
+
+AsyncEvent::AsyncEvent(AsyncEventMode mode, bool set)
+    : mode_(mode), set_(set) {}
+
+AsyncEvent::WaitTask AsyncEvent::Wait(stdx::stop_token stop_token) {
+  return WaitTask(this, std::move(stop_token));
+}
+
+void AsyncEvent::Set() {
+  if (mode_ == AsyncEventMode::kAutoReset) {
+    if (WaitTask* waiter = waiters_.PopFront()) {
+      std::exchange(waiter->handle_, nullptr).resume();
+    } else {
+      set_ = true;
+    }
+    return;
+  }
+  set_ = true;
+  // Waiters are unlinked one by one right before being resumed, so cancelling
+  // any of the remaining ones from a resumed coroutine is a no-op.
+  util::IntrusiveList<WaitTask> waiters;
+  waiters.Splice(waiters_);
+  while (WaitTask* waiter = waiters.PopFront()) {
+    std::exchange(waiter->handle_, nullptr).resume();
+  }
+}
+
+AsyncEvent::WaitTask::WaitTask(AsyncEvent* event, stdx::stop_token stop_token)
+    : event_(event), stop_callback_(std::move(stop_token), OnCancel{this}) {}
+
+AsyncEvent::WaitTask::~WaitTask() {
+  if (event_->waiters_.Contains(this)) {
+    event_->waiters_.Remove(this);
+  }
+}
+
+bool AsyncEvent::WaitTask::await_ready() {
+  if (interrupted_) {
+    return true;
+  }
+  if (event_->set_) {
+    if (event_->mode_ == AsyncEventMode::kAutoReset) {
+      event_->set_ = false;
+    }
+    return true;
+  }
+  return false;
+}
+
+void AsyncEvent::WaitTask::await_suspend(stdx::coroutine_handle<void> handle) {
+  handle_ = handle;
+  event_->waiters_.PushBack(this);
+}
+
+void AsyncEvent::WaitTask::await_resume() const {
+  if (interrupted_) {
+    throw InterruptedException();
+  }
+}
+
+Expected<void> AsyncEvent::WaitTask::await_resume_expected() const {
+  if (interrupted_) {
+    return Unexpected::Interrupted();
+  }
+  return {};
+}
+
+void AsyncEvent::WaitTask::OnCancel::operator()() const {
+  if (task->handle_ && !task->event_->waiters_.Contains(task)) {
+    // Already being resumed by Set.
+    return;
+  }
+  task->interrupted_ = true;
+  if (task->handle_) {
+    task->event_->waiters_.Remove(task);
+    std::exchange(task->handle_, nullptr).resume();
+  }
+}
+
+}  // namespace coro
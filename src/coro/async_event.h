@@ -0,0 +1,80 @@
+#ifndef CORO_ASYNC_EVENT_H
+#define CORO_ASYNC_EVENT_H
+
+#include "coro/expected.h"
+#include "coro/stdx/coroutine.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/util/intrusive_list.h"
+
+namespace coro {
+
+enum class AsyncEventMode {
+  // Once set, the event stays set and lets all waiters through until Reset.
+  kManualReset,
+  // Set lets exactly one waiter through; with no waiters the event stays set
+  // until the next Wait consumes it.
+  kAutoReset,
+};
+
+// Reusable event. Waiting is allocation free: the awaiter returned by Wait
+// links itself into the event's waiter list.
+class AsyncEvent {
+ public:
+  class WaitTask;
+
+  explicit AsyncEvent(AsyncEventMode mode = AsyncEventMode::kManualReset,
+                      bool set = false);
+  AsyncEvent(const AsyncEvent&) = delete;
+  AsyncEvent(AsyncEvent&&) = delete;
+  AsyncEvent& operator=(const AsyncEvent&) = delete;
+  AsyncEvent& operator=(AsyncEvent&&) = delete;
+
+  // Throws InterruptedException if `stop_token` gets stopped before the event
+  // was set.
+  WaitTask Wait(stdx::stop_token stop_token = stdx::stop_token());
+  void Set();
+  void Reset() { set_ = false; }
+
+  AsyncEventMode mode() const { return mode_; }
+  bool is_set() const { return set_; }
+  size_t waiter_count() const { return waiters_.size(); }
+
+ private:
+  AsyncEventMode mode_;
+  bool set_;
+  util::IntrusiveList<WaitTask> waiters_;
+};
+
+class AsyncEvent::WaitTask : public util::IntrusiveListNode<WaitTask> {
+ public:
+  WaitTask(AsyncEvent* event, stdx::stop_token stop_token);
+  ~WaitTask();
+
+  WaitTask(const WaitTask&) = delete;
+  WaitTask(WaitTask&&) = delete;
+  WaitTask& operator=(const WaitTask&) = delete;
+  WaitTask& operator=(WaitTask&&) = delete;
+
+  bool await_ready();
+  void await_suspend(stdx::coroutine_handle<void> handle);
+  void await_resume() const;
+  Expected<void> await_resume_expected() const;
+
+ private:
+  friend class AsyncEvent;
+
+  struct OnCancel {
+    void operator()() const;
+    WaitTask* task;
+  };
+
+  AsyncEvent* event_;
+  stdx::coroutine_handle<void> handle_;
+  bool interrupted_ = false;
+  stdx::stop_callback<OnCancel> stop_callback_;
+};
+
+}  // namespace coro
+
+#endif  // CORO_ASYNC_EVENT_H
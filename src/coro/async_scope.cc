@@ -0,0 +1,39 @@
+#include "coro/async_scope.h"
+
+#include "coro/util/raii_utils.h"
+
+namespace coro {
+
+using ::coro::util::AtScopeExit;
+
+AsyncScope::AsyncScope() : AsyncScope(stdx::stop_token()) {}
+
+AsyncScope::AsyncScope(stdx::stop_token stop_token)
+    : state_(std::make_shared<State>(stop_token.deadline())),
+      on_parent_stop_(std::move(stop_token),
+                      OnParentStop{state_->stop_source}) {}
+
+AsyncScope::~AsyncScope() { RequestStop(); }
+
+void AsyncScope::Spawn(Task<> task) {
+  if (state_->active_count++ == 0) {
+    state_->drained.Reset();
+  }
+  state_->spawned_count++;
+  RunTask(Run, state_, std::move(task));
+}
+
+Task<> AsyncScope::Join(stdx::stop_token stop_token) {
+  co_await state_->drained.Wait(std::move(stop_token));
+}
+
+Task<> AsyncScope::Run(std::shared_ptr<State> state, Task<> task) {
+  auto guard = AtScopeExit([&] {
+    if (--state->active_count == 0) {
+      state->drained.Set();
+    }
+  });
+  co_await task;
+}
+
+}  // namespace coro
@@ -0,0 +1,85 @@
+#ifndef CORO_ASYNC_SCOPE_H
+#define CORO_ASYNC_SCOPE_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "coro/async_event.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+
+namespace coro {
+
+// Owns detached coroutines. Unlike RunTask, the scope keeps track of the
+// coroutines it spawned, cancels them as a group and lets others await until
+// all of them finished.
+//
+// Spawned coroutines observe cancellation through get_token(). As with
+// RunTask, InterruptedException thrown by a spawned coroutine is swallowed.
+// Destroying the scope requests a stop but doesn't wait; the coroutines still
+// running then finish on their own.
+class AsyncScope {
+ public:
+  AsyncScope();
+  // The scope also stops once `stop_token` does, and get_token() carries its
+  // deadline.
+  explicit AsyncScope(stdx::stop_token stop_token);
+  ~AsyncScope();
+
+  AsyncScope(const AsyncScope&) = delete;
+  AsyncScope(AsyncScope&&) = delete;
+  AsyncScope& operator=(const AsyncScope&) = delete;
+  AsyncScope& operator=(AsyncScope&&) = delete;
+
+  void Spawn(Task<> task);
+
+  template <typename F, typename... Args>
+  void Spawn(F func, Args&&... args) {
+    Spawn(Invoke<F, Args...>(std::move(func), std::forward<Args>(args)...));
+  }
+
+  void RequestStop() { state_->stop_source.request_stop(); }
+  stdx::stop_token get_token() const { return state_->stop_source.get_token(); }
+
+  // Resumes once no spawned coroutine is running.
+  Task<> Join(stdx::stop_token stop_token = stdx::stop_token());
+
+  // Number of spawned coroutines which didn't finish yet.
+  size_t active_count() const { return state_->active_count; }
+  uint64_t spawned_count() const { return state_->spawned_count; }
+
+ private:
+  struct State {
+    explicit State(std::chrono::steady_clock::time_point deadline)
+        : stop_source(deadline) {}
+
+    stdx::stop_source stop_source;
+    AsyncEvent drained{AsyncEventMode::kManualReset, /*set=*/true};
+    size_t active_count = 0;
+    uint64_t spawned_count = 0;
+  };
+
+  template <typename F, typename... Args>
+  static Task<> Invoke(F func, std::decay_t<Args>... args) {
+    co_await func(std::move(args)...);
+  }
+
+  struct OnParentStop {
+    void operator()() { stop_source.request_stop(); }
+
+    stdx::stop_source stop_source;
+  };
+
+  static Task<> Run(std::shared_ptr<State> state, Task<> task);
+
+  std::shared_ptr<State> state_;
+  stdx::stop_callback<OnParentStop> on_parent_stop_;
+};
+
+}  // namespace coro
+
+#endif  // CORO_ASYNC_SCOPE_H
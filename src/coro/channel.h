@@ -0,0 +1,283 @@
+#ifndef CORO_CHANNEL_H
+#define CORO_CHANNEL_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "coro/exception.h"
+#include "coro/interrupted_exception.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+#include "coro/util/event_loop.h"
+#include "coro/util/intrusive_list.h"
+#include "coro/util/raii_utils.h"
+
+namespace coro {
+
+class ChannelClosedException : public Exception {
+ public:
+  explicit ChannelClosedException(
+      stdx::source_location location = stdx::source_location::current(),
+      stdx::stacktrace stacktrace = stdx::stacktrace::current())
+      : Exception(std::move(location), std::move(stacktrace)) {}
+
+  [[nodiscard]] const char* what() const noexcept final {
+    return "channel closed";
+  }
+};
+
+// Bounded FIFO queue connecting any number of producers with any number of
+// consumers. Send waits while the channel is full; values are handed directly
+// to a waiting receiver, bypassing the buffer. With zero capacity each Send
+// waits until a receiver took its value.
+//
+// A channel constructed without an EventLoop does no synchronization at all;
+// all of its users have to run on the same event loop. A channel constructed
+// with an EventLoop is thread safe: coroutines awaiting Send / Receive have to
+// run on that event loop and get resumed through it, other threads use
+// BlockingSend / BlockingReceive.
+template <typename T>
+class Channel {
+ public:
+  explicit Channel(size_t capacity) : capacity_(capacity) {}
+  Channel(const util::EventLoop* event_loop, size_t capacity)
+      : event_loop_(event_loop), capacity_(capacity) {}
+
+  Channel(const Channel&) = delete;
+  Channel(Channel&&) = delete;
+  Channel& operator=(const Channel&) = delete;
+  Channel& operator=(Channel&&) = delete;
+
+  // Throws ChannelClosedException if the channel is or gets closed before the
+  // value was accepted, InterruptedException if `stop_token` gets stopped
+  // before that.
+  Task<> Send(T value, stdx::stop_token stop_token = stdx::stop_token()) {
+    Waiter waiter;
+    {
+      auto lock = Lock();
+      if (TrySendLocked(value)) {
+        co_return;
+      }
+      waiter.value = std::move(value);
+      senders_.PushBack(&waiter);
+    }
+    co_await Suspend(&senders_, &waiter, std::move(stop_token));
+  }
+
+  // Returns std::nullopt once the channel is closed and drained.
+  Task<std::optional<T>> Receive(
+      stdx::stop_token stop_token = stdx::stop_token()) {
+    Waiter waiter;
+    {
+      auto lock = Lock();
+      if (auto value = TryReceiveLocked()) {
+        co_return value;
+      }
+      if (closed_) {
+        co_return std::nullopt;
+      }
+      receivers_.PushBack(&waiter);
+    }
+    co_await Suspend(&receivers_, &waiter, std::move(stop_token));
+    co_return std::move(waiter.value);
+  }
+
+  // Blocks the calling thread, which mustn't be the thread running the event
+  // loop. Only for thread safe channels.
+  void BlockingSend(T value) {
+    auto lock = LockBlocking();
+    if (TrySendLocked(value)) {
+      return;
+    }
+    Waiter waiter;
+    waiter.value = std::move(value);
+    waiter.blocking = true;
+    senders_.PushBack(&waiter);
+    blocking_condition_variable_.wait(lock, [&] { return waiter.done; });
+    if (waiter.exception) {
+      std::rethrow_exception(waiter.exception);
+    }
+  }
+
+  std::optional<T> BlockingReceive() {
+    auto lock = LockBlocking();
+    if (auto value = TryReceiveLocked()) {
+      return value;
+    }
+    if (closed_) {
+      return std::nullopt;
+    }
+    Waiter waiter;
+    waiter.blocking = true;
+    receivers_.PushBack(&waiter);
+    blocking_condition_variable_.wait(lock, [&] { return waiter.done; });
+    return std::move(waiter.value);
+  }
+
+  // Values already in the buffer can still be received. Pending senders fail
+  // with ChannelClosedException, pending receivers get std::nullopt.
+  void Close() {
+    auto lock = Lock();
+    if (closed_) {
+      return;
+    }
+    closed_ = true;
+    util::IntrusiveList<Waiter> senders;
+    senders.Splice(senders_);
+    util::IntrusiveList<Waiter> receivers;
+    receivers.Splice(receivers_);
+    while (Waiter* waiter = senders.PopFront()) {
+      Wake(waiter, std::make_exception_ptr(ChannelClosedException()));
+    }
+    while (Waiter* waiter = receivers.PopFront()) {
+      Wake(waiter);
+    }
+  }
+
+  bool closed() const {
+    auto lock = Lock();
+    return closed_;
+  }
+
+  size_t size() const {
+    auto lock = Lock();
+    return buffer_.size();
+  }
+
+  size_t capacity() const { return capacity_; }
+
+ private:
+  struct Waiter : util::IntrusiveListNode<Waiter> {
+    std::optional<T> value;
+    std::exception_ptr exception;
+    // Coroutine suspended on the waiter, if any.
+    stdx::coroutine_handle<void> handle;
+    std::optional<util::EventLoop::ScheduleTask> schedule;
+    bool blocking = false;
+    bool done = false;
+  };
+
+  struct WakeAwaiter {
+    bool await_ready() const {
+      auto lock = channel->Lock();
+      return waiter->done;
+    }
+    bool await_suspend(stdx::coroutine_handle<void> handle) {
+      auto lock = channel->Lock();
+      if (waiter->done) {
+        return false;
+      }
+      waiter->handle = handle;
+      return true;
+    }
+    void await_resume() const {}
+
+    Channel* channel;
+    Waiter* waiter;
+  };
+
+  std::unique_lock<std::mutex> Lock() const {
+    if (event_loop_) {
+      return std::unique_lock(mutex_);
+    } else {
+      return std::unique_lock<std::mutex>();
+    }
+  }
+
+  std::unique_lock<std::mutex> LockBlocking() const {
+    if (!event_loop_) {
+      throw LogicError("blocking operations require a thread safe channel");
+    }
+    return std::unique_lock(mutex_);
+  }
+
+  bool TrySendLocked(T& value) {
+    if (closed_) {
+      throw ChannelClosedException();
+    }
+    if (Waiter* receiver = receivers_.PopFront()) {
+      receiver->value = std::move(value);
+      Wake(receiver);
+      return true;
+    }
+    if (buffer_.size() < capacity_) {
+      buffer_.emplace_back(std::move(value));
+      return true;
+    }
+    return false;
+  }
+
+  std::optional<T> TryReceiveLocked() {
+    std::optional<T> value;
+    if (!buffer_.empty()) {
+      value.emplace(std::move(buffer_.front()));
+      buffer_.pop_front();
+      if (Waiter* sender = senders_.PopFront()) {
+        buffer_.emplace_back(std::move(*sender->value));
+        Wake(sender);
+      }
+    } else if (Waiter* sender = senders_.PopFront()) {
+      value.emplace(std::move(*sender->value));
+      Wake(sender);
+    }
+    return value;
+  }
+
+  Task<> Suspend(util::IntrusiveList<Waiter>* list, Waiter* waiter,
+                 stdx::stop_token stop_token) {
+    auto guard = util::AtScopeExit([&] {
+      auto lock = Lock();
+      if (list->Contains(waiter)) {
+        list->Remove(waiter);
+      }
+    });
+    stdx::stop_callback stop_callback(std::move(stop_token), [&] {
+      auto lock = Lock();
+      if (list->Contains(waiter)) {
+        list->Remove(waiter);
+        Wake(waiter, std::make_exception_ptr(InterruptedException()));
+      }
+    });
+    co_await WakeAwaiter{this, waiter};
+    if (waiter->exception) {
+      std::rethrow_exception(waiter->exception);
+    }
+  }
+
+  // Called with the waiter already unlinked and the lock held. In a single
+  // threaded channel this resumes the waiter right away, so the channel has to
+  // be in a consistent state. A thread safe channel resumes it through the
+  // event loop's ready queue, which is only handed over to the event loop
+  // when woken on another thread.
+  void Wake(Waiter* waiter, std::exception_ptr exception = nullptr) {
+    waiter->exception = std::move(exception);
+    waiter->done = true;
+    if (waiter->blocking) {
+      blocking_condition_variable_.notify_all();
+    } else if (!waiter->handle) {
+      // Not suspended yet, WakeAwaiter won't suspend anymore.
+    } else if (event_loop_) {
+      waiter->schedule.emplace(event_loop_).await_suspend(waiter->handle);
+    } else {
+      waiter->handle.resume();
+    }
+  }
+
+  const util::EventLoop* event_loop_ = nullptr;
+  size_t capacity_;
+  bool closed_ = false;
+  std::deque<T> buffer_;
+  util::IntrusiveList<Waiter> senders_;
+  util::IntrusiveList<Waiter> receivers_;
+  mutable std::mutex mutex_;
+  std::condition_variable blocking_condition_variable_;
+};
+
+}  // namespace coro
+
+#endif  // CORO_CHANNEL_H
@@ -0,0 +1,203 @@
+#ifndef CORO_CONCURRENT_MAP_H
+#define CORO_CONCURRENT_MAP_H
+
+#include <deque>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "coro/exception.h"
+#include "coro/generator.h"
+#include "coro/promise.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/task.h"
+#include "coro/util/raii_utils.h"
+
+namespace coro {
+
+enum class ConcurrentMapOrder {
+  // Results are yielded in the order of the input items.
+  kInput,
+  // Results are yielded as soon as they are ready.
+  kCompletion,
+};
+
+namespace internal {
+
+template <typename F, typename Item>
+auto InvokeConcurrentMapFunc(F& func, Item item, stdx::stop_token stop_token) {
+  if constexpr (std::is_invocable_v<F&, Item, stdx::stop_token>) {
+    return func(std::move(item), std::move(stop_token));
+  } else {
+    return func(std::move(item));
+  }
+}
+
+template <typename F, typename Item>
+using ConcurrentMapResultT = typename decltype(InvokeConcurrentMapFunc(
+    std::declval<F&>(), std::declval<Item>(),
+    std::declval<stdx::stop_token>()))::type;
+
+template <typename R, typename F>
+struct ConcurrentMapState {
+  F func;
+  size_t max_in_flight;
+  ConcurrentMapOrder order;
+  stdx::stop_source stop_source;
+  size_t in_flight = 0;
+  uint64_t next_output = 0;
+  // Results which were not yielded yet. With ConcurrentMapOrder::kInput there
+  // is a slot for every item in flight too, so that the item with index i
+  // lands at ready[i - next_output].
+  std::deque<std::optional<R>> ready;
+  std::exception_ptr exception;
+  Promise<void>* waiter = nullptr;
+
+  size_t GetPendingCount() const {
+    return order == ConcurrentMapOrder::kInput ? ready.size()
+                                               : ready.size() + in_flight;
+  }
+};
+
+template <typename State, typename Item>
+Task<> RunConcurrentMapTask(std::shared_ptr<State> state, uint64_t index,
+                            Item item) {
+  try {
+    auto result = co_await InvokeConcurrentMapFunc(
+        state->func, std::move(item), state->stop_source.get_token());
+    if (state->order == ConcurrentMapOrder::kInput) {
+      state->ready[index - state->next_output].emplace(std::move(result));
+    } else {
+      state->ready.emplace_back(std::move(result));
+    }
+  } catch (...) {
+    if (!state->exception) {
+      state->exception = std::current_exception();
+    }
+  }
+  state->in_flight--;
+  if (state->waiter) {
+    std::exchange(state->waiter, nullptr)->SetValue();
+  }
+}
+
+// Turns a func producing Task<> into one producing a placeholder value, which
+// ConcurrentMap can buffer.
+template <typename F>
+struct ConcurrentForEachFunc {
+  template <typename Item>
+  Task<std::monostate> operator()(Item item, stdx::stop_token stop_token) {
+    co_await InvokeConcurrentMapFunc(func, std::move(item),
+                                     std::move(stop_token));
+    co_return std::monostate();
+  }
+
+  F func;
+};
+
+template <typename Container>
+Generator<typename Container::value_type> ToGenerator(Container container) {
+  for (auto& item : container) {
+    co_yield std::move(item);
+  }
+}
+
+}  // namespace internal
+
+// Yields func(item) for every item of `input`, keeping at most
+// `max_in_flight` invocations running at once. If func accepts a stop token
+// as a second argument, it gets one which is stopped once the generator is
+// destroyed or fails, or once `stop_token` is; it carries the deadline of
+// `stop_token`.
+//
+// With ConcurrentMapOrder::kInput, results completed ahead of their turn are
+// buffered; the number of buffered and running items together never exceeds
+// `max_in_flight`. The first exception thrown by func is rethrown right away.
+template <typename T, typename F,
+          typename R = internal::ConcurrentMapResultT<F, T>>
+Generator<R> ConcurrentMap(
+    Generator<T> input, F func, size_t max_in_flight,
+    ConcurrentMapOrder order = ConcurrentMapOrder::kInput,
+    stdx::stop_token stop_token = stdx::stop_token()) {
+  static_assert(!std::is_void_v<R>,
+                "func returning Task<> has to go through ConcurrentForEach");
+  using State = internal::ConcurrentMapState<R, F>;
+  if (max_in_flight == 0) {
+    throw InvalidArgument("max_in_flight has to be positive");
+  }
+  auto state = std::make_shared<State>(
+      State{.func = std::move(func),
+            .max_in_flight = max_in_flight,
+            .order = order,
+            .stop_source = stdx::stop_source(stop_token.deadline())});
+  auto guard = util::AtScopeExit([&] {
+    state->waiter = nullptr;
+    state->stop_source.request_stop();
+  });
+  stdx::stop_callback stop_callback(
+      std::move(stop_token), [&] { state->stop_source.request_stop(); });
+  uint64_t next_input = 0;
+  auto it = co_await input.begin();
+  bool exhausted = it == input.end();
+  while (true) {
+    while (!exhausted && !state->exception &&
+           state->GetPendingCount() < max_in_flight) {
+      state->in_flight++;
+      if (order == ConcurrentMapOrder::kInput) {
+        state->ready.emplace_back();
+      }
+      RunTask(internal::RunConcurrentMapTask<State, T>(state, next_input++,
+                                                       std::move(*it)));
+      co_await ++it;
+      exhausted = it == input.end();
+    }
+    if (state->exception) {
+      std::rethrow_exception(state->exception);
+    }
+    if (!state->ready.empty() && state->ready.front()) {
+      R result = std::move(*state->ready.front());
+      state->ready.pop_front();
+      state->next_output++;
+      co_yield std::move(result);
+      continue;
+    }
+    if (exhausted && state->in_flight == 0) {
+      break;
+    }
+    Promise<void> semaphore;
+    state->waiter = &semaphore;
+    co_await semaphore;
+  }
+}
+
+template <typename Container, typename F>
+auto ConcurrentMap(Container input, F func, size_t max_in_flight,
+                   ConcurrentMapOrder order = ConcurrentMapOrder::kInput,
+                   stdx::stop_token stop_token = stdx::stop_token()) {
+  return ConcurrentMap(internal::ToGenerator(std::move(input)), std::move(func),
+                       max_in_flight, order, std::move(stop_token));
+}
+
+// Awaits func(item) for every item of `input`, a generator or a container,
+// keeping at most `max_in_flight` invocations running at once. Completes once
+// all of them did; the first exception thrown by func stops the others and is
+// rethrown. Stop tokens are passed to func like with ConcurrentMap.
+template <typename Input, typename F>
+Task<> ConcurrentForEach(Input input, F func, size_t max_in_flight,
+                         stdx::stop_token stop_token = stdx::stop_token()) {
+  auto results = ConcurrentMap(
+      std::move(input), internal::ConcurrentForEachFunc<F>{std::move(func)},
+      max_in_flight, ConcurrentMapOrder::kCompletion, std::move(stop_token));
+  auto it = co_await results.begin();
+  while (it != results.end()) {
+    co_await ++it;
+  }
+}
+
+}  // namespace coro
+
+#endif  // CORO_CONCURRENT_MAP_H
@@ -0,0 +1,128 @@
+#ifndef CORO_DEADLINE_H
+#define CORO_DEADLINE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <memory>
+#include <utility>
+
+#include "coro/exception.h"
+#include "coro/interrupted_exception.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+#include "coro/util/event_loop.h"
+#include "coro/util/raii_utils.h"
+
+namespace coro {
+
+using Deadline = std::chrono::steady_clock::time_point;
+
+class TimeoutException : public Exception {
+ public:
+  explicit TimeoutException(
+      stdx::source_location location = stdx::source_location::current(),
+      stdx::stacktrace stacktrace = stdx::stacktrace::current())
+      : Exception(std::move(location), std::move(stacktrace)) {}
+
+  [[nodiscard]] const char* what() const noexcept final {
+    return "deadline exceeded";
+  }
+};
+
+// Deadline carried by `stop_token`, Deadline::max() if there is none.
+inline Deadline GetDeadline(const stdx::stop_token& stop_token) {
+  return stop_token.deadline();
+}
+
+// Time left until the deadline carried by `stop_token`, never negative;
+// std::chrono::milliseconds::max() if there is no deadline.
+inline std::chrono::milliseconds GetRemainingTime(
+    const stdx::stop_token& stop_token) {
+  Deadline deadline = GetDeadline(stop_token);
+  if (deadline == Deadline::max()) {
+    return std::chrono::milliseconds::max();
+  }
+  auto now = std::chrono::steady_clock::now();
+  if (deadline <= now) {
+    return std::chrono::milliseconds::zero();
+  }
+  return std::chrono::ceil<std::chrono::milliseconds>(deadline - now);
+}
+
+namespace internal {
+
+// Shared with the timer, which may still fire after WithDeadline finished on
+// another thread.
+struct DeadlineState {
+  explicit DeadlineState(Deadline deadline) : stop_source(deadline) {}
+
+  stdx::stop_source stop_source;
+  std::atomic<bool> timed_out = false;
+};
+
+inline Task<> StopAtDeadline(const util::EventLoop* event_loop,
+                             std::chrono::milliseconds timeout,
+                             stdx::stop_token stop_token,
+                             std::shared_ptr<DeadlineState> state) {
+  co_await event_loop->Wait(
+      static_cast<int>(std::min<std::chrono::milliseconds::rep>(
+          timeout.count(), INT_MAX)),
+      std::move(stop_token));
+  state->timed_out = true;
+  state->stop_source.request_stop();
+}
+
+}  // namespace internal
+
+// Runs func(stop_token) with a stop token which gets stopped when `stop_token`
+// does or once `deadline` passes. The token carries the earlier of `deadline`
+// and the deadline of `stop_token`, so nested calls inherit the remaining
+// budget through GetDeadline. Throws TimeoutException if func got interrupted
+// because of the deadline.
+template <typename F>
+auto WithDeadline(const util::EventLoop& event_loop, Deadline deadline, F func,
+                  stdx::stop_token stop_token = stdx::stop_token())
+    -> Task<typename decltype(func(std::declval<stdx::stop_token>()))::type> {
+  deadline = std::min(deadline, GetDeadline(stop_token));
+  auto state = std::make_shared<internal::DeadlineState>(deadline);
+  stdx::stop_callback stop_callback(
+      std::move(stop_token), [&] { state->stop_source.request_stop(); });
+  stdx::stop_source timer_stop_source;
+  auto guard = util::AtScopeExit([&] { timer_stop_source.request_stop(); });
+  if (deadline != Deadline::max()) {
+    auto timeout = GetRemainingTime(state->stop_source.get_token());
+    if (timeout == std::chrono::milliseconds::zero()) {
+      throw TimeoutException();
+    }
+    RunTask(internal::StopAtDeadline, &event_loop, timeout,
+            timer_stop_source.get_token(), state);
+  }
+  try {
+    co_return co_await func(state->stop_source.get_token());
+  } catch (const InterruptedException&) {
+    if (state->timed_out) {
+      throw TimeoutException();
+    }
+    throw;
+  }
+}
+
+// WithDeadline with the deadline `timeout` from now.
+template <typename F, typename Rep, typename Period>
+auto WithTimeout(const util::EventLoop& event_loop, F func,
+                 std::chrono::duration<Rep, Period> timeout,
+                 stdx::stop_token stop_token = stdx::stop_token()) {
+  return WithDeadline(
+      event_loop,
+      std::chrono::steady_clock::now() +
+          std::chrono::ceil<std::chrono::steady_clock::duration>(timeout),
+      std::move(func), std::move(stop_token));
+}
+
+}  // namespace coro
+
+#endif  // CORO_DEADLINE_H
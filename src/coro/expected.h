@@ -0,0 +1,245 @@
+#ifndef CORO_EXPECTED_H
+#define CORO_EXPECTED_H
+
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "coro/interrupted_exception.h"
+#include "coro/stdx/coroutine.h"
+#include "coro/task.h"
+
+namespace coro {
+
+// Error held by an Expected. A null exception denotes an interruption, which
+// is free to create and to propagate, as no exception object exists until
+// someone calls Rethrow.
+class Unexpected {
+ public:
+  explicit Unexpected(std::exception_ptr exception)
+      : exception_(std::move(exception)) {}
+
+  static Unexpected Interrupted() { return Unexpected(nullptr); }
+
+  bool interrupted() const { return !exception_; }
+
+  [[noreturn]] void Rethrow() const {
+    if (!exception_) {
+      throw InterruptedException();
+    }
+    std::rethrow_exception(exception_);
+  }
+
+ private:
+  std::exception_ptr exception_;
+};
+
+// Result of an operation which reports failures, interruptions in particular,
+// as values instead of exceptions. A coroutine returning Task<Expected<T>> can
+// pass an error on with `co_return expected.error();`.
+template <typename T>
+class Expected {
+ public:
+  static_assert(!std::is_reference_v<T>);
+
+  Expected(T value) : result_(std::in_place_index<0>, std::move(value)) {}
+  Expected(Unexpected error) : result_(std::in_place_index<1>, error) {}
+
+  bool has_value() const { return result_.index() == 0; }
+  explicit operator bool() const { return has_value(); }
+
+  const Unexpected& error() const { return std::get<1>(result_); }
+
+  // Throws the error, if any.
+  T& value() & {
+    if (!has_value()) {
+      error().Rethrow();
+    }
+    return std::get<0>(result_);
+  }
+  const T& value() const& {
+    if (!has_value()) {
+      error().Rethrow();
+    }
+    return std::get<0>(result_);
+  }
+  T&& value() && {
+    if (!has_value()) {
+      error().Rethrow();
+    }
+    return std::get<0>(std::move(result_));
+  }
+
+  T& operator*() & { return std::get<0>(result_); }
+  const T& operator*() const& { return std::get<0>(result_); }
+  T&& operator*() && { return std::get<0>(std::move(result_)); }
+  T* operator->() { return &std::get<0>(result_); }
+  const T* operator->() const { return &std::get<0>(result_); }
+
+ private:
+  std::variant<T, Unexpected> result_;
+};
+
+template <>
+class Expected<void> {
+ public:
+  Expected() = default;
+  Expected(Unexpected error) : error_(error) {}
+
+  bool has_value() const { return !error_; }
+  explicit operator bool() const { return has_value(); }
+
+  const Unexpected& error() const { return *error_; }
+
+  void value() const {
+    if (error_) {
+      error_->Rethrow();
+    }
+  }
+
+ private:
+  std::optional<Unexpected> error_;
+};
+
+namespace internal {
+
+template <typename T>
+concept HasMemberCoAwait =
+    requires(T&& awaitable) { std::forward<T>(awaitable).operator co_await(); };
+
+template <typename Awaiter>
+class AsExpectedAwaiter {
+ public:
+  using ResultT = decltype(std::declval<Awaiter&>().await_resume());
+
+  explicit AsExpectedAwaiter(Awaiter awaiter)
+      : awaiter_(std::forward<Awaiter>(awaiter)) {}
+
+  bool await_ready() { return awaiter_.await_ready(); }
+
+  template <typename Handle>
+  decltype(auto) await_suspend(Handle handle) {
+    return awaiter_.await_suspend(handle);
+  }
+
+  Expected<std::decay_t<ResultT>> await_resume() {
+    if constexpr (requires { awaiter_.await_resume_expected(); }) {
+      return awaiter_.await_resume_expected();
+    } else {
+      try {
+        if constexpr (std::is_void_v<ResultT>) {
+          awaiter_.await_resume();
+          return {};
+        } else {
+          return awaiter_.await_resume();
+        }
+      } catch (const InterruptedException&) {
+        return Unexpected::Interrupted();
+      } catch (...) {
+        return Unexpected(std::current_exception());
+      }
+    }
+  }
+
+ private:
+  Awaiter awaiter_;
+};
+
+}  // namespace internal
+
+// Awaits `awaitable`, reporting its failure as an Unexpected instead of
+// throwing. Awaitables exposing await_resume_expected() don't throw at all
+// when interrupted; for the others the exception is caught.
+template <typename Awaitable>
+auto AsExpected(Awaitable&& awaitable) {
+  if constexpr (internal::HasMemberCoAwait<Awaitable>) {
+    using Awaiter =
+        decltype(std::forward<Awaitable>(awaitable).operator co_await());
+    return internal::AsExpectedAwaiter<Awaiter>(
+        std::forward<Awaitable>(awaitable).operator co_await());
+  } else {
+    return internal::AsExpectedAwaiter<Awaitable&>(awaitable);
+  }
+}
+
+// Awaitable over a Task<Expected<T>> whose result is `value()` of the
+// Expected converted to `Result`, so the error gets thrown. Lets a throwing
+// API share the coroutine of its Expected flavor instead of wrapping it in a
+// coroutine of its own. AsExpected on it doesn't throw at all.
+//
+// Stands in for a Task<Result>: it has the same `type`, is awaitable both as
+// an lvalue and as an rvalue, and converts to a Task<Result>, which is only
+// then wrapped in another coroutine.
+template <typename T, typename Result = T>
+class [[nodiscard]] ValueTask {
+ public:
+  using value_type = Result;
+  using type = Result;
+
+  explicit ValueTask(Task<Expected<T>> task) : task_(std::move(task)) {}
+
+  operator Task<Result>() && { return ToTask(std::move(task_)); }
+
+  auto operator co_await() const& noexcept {
+    return Awaiter<decltype(task_.operator co_await())>(
+        task_.operator co_await());
+  }
+
+  auto operator co_await() const&& noexcept {
+    return Awaiter<decltype(std::move(task_).operator co_await())>(
+        std::move(task_).operator co_await());
+  }
+
+ private:
+  template <typename TaskAwaiter>
+  class Awaiter {
+   public:
+    explicit Awaiter(TaskAwaiter awaiter) : awaiter_(std::move(awaiter)) {}
+
+    bool await_ready() const noexcept { return awaiter_.await_ready(); }
+
+    stdx::coroutine_handle<> await_suspend(
+        stdx::coroutine_handle<> handle) noexcept {
+      return awaiter_.await_suspend(handle);
+    }
+
+    Result await_resume() {
+      if constexpr (std::is_void_v<T>) {
+        awaiter_.await_resume().value();
+      } else {
+        return awaiter_.await_resume().value();
+      }
+    }
+
+    Expected<std::decay_t<Result>> await_resume_expected() {
+      if constexpr (std::is_same_v<std::decay_t<Result>, T>) {
+        return awaiter_.await_resume();
+      } else {
+        auto&& result = awaiter_.await_resume();
+        if (!result) {
+          return result.error();
+        }
+        return static_cast<Result>(*result);
+      }
+    }
+
+   private:
+    TaskAwaiter awaiter_;
+  };
+
+  static Task<Result> ToTask(Task<Expected<T>> task) {
+    if constexpr (std::is_void_v<Result>) {
+      co_await ValueTask(std::move(task));
+    } else {
+      co_return co_await ValueTask(std::move(task));
+    }
+  }
+
+  Task<Expected<T>> task_;
+};
+
+}  // namespace coro
+
+#endif  // CORO_EXPECTED_H
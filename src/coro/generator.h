@@ -7,6 +7,7 @@
 
 #include "coro/stdx/coroutine.h"
 #include "coro/task.h"
+#include "coro/util/frame_pool.h"
 
 namespace coro {
 
@@ -19,7 +20,7 @@ class async_generator_iterator;
 class async_generator_yield_operation;
 class async_generator_advance_operation;
 
-class async_generator_promise_base {
+class async_generator_promise_base : public util::PooledFrame {
  public:
   async_generator_promise_base() noexcept : exception_(nullptr) {
     // Other variables left intentionally uninitialised as they're
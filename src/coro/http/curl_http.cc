@@ -4,6 +4,8 @@
 #include <event2/event.h>
 #include <event2/event_struct.h>
 
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <memory>
@@ -13,6 +15,7 @@
 #include <utility>
 #include <variant>
 
+#include "coro/deadline.h"
 #include "coro/http/http_body_generator.h"
 #include "coro/interrupted_exception.h"
 
@@ -213,6 +216,8 @@ class CurlHttpImpl {
   CurlHttpOperation Fetch(Request<> request,
                           stdx::stop_token = stdx::stop_token()) const;
 
+  const CurlHttpConfig& config() const { return config_; }
+
  private:
   static int SocketCallback(CURL* handle, curl_socket_t socket, int what,
                             void* userp, void* socketp);
@@ -396,6 +401,14 @@ CurlHandle::CurlHandle(CURLM* http, event_base* event_loop, Request<> request,
   if (request.method == Method::kHead) {
     Check(curl_easy_setopt(handle_.get(), CURLOPT_NOBODY, 1L));
   }
+  if (auto remaining = GetRemainingTime(stop_token_);
+      remaining != std::chrono::milliseconds::max()) {
+    // Lets curl give up on its own once the inherited deadline passes.
+    Check(curl_easy_setopt(
+        handle_.get(), CURLOPT_TIMEOUT_MS,
+        static_cast<long>(std::max<std::chrono::milliseconds::rep>(
+            remaining.count(), 1))));
+  }
   if (config.alt_svc_path) {
     Check(curl_easy_setopt(handle_.get(), CURLOPT_ALTSVC,
                            config.alt_svc_path->c_str()));
@@ -706,6 +719,12 @@ std::string GetNativeCaCertBlob() {
   return blob;
 }
 
+Task<std::string> GetNativeCaCertBlob(util::ThreadPool* thread_pool,
+                                      stdx::stop_token stop_token) {
+  co_return co_await thread_pool->Do(std::move(stop_token),
+                                     [] { return GetNativeCaCertBlob(); });
+}
+
 CurlHttp::CurlHttp(const coro::util::EventLoop* event_loop,
                    CurlHttpConfig config)
     : d_(new Impl{
@@ -720,6 +739,9 @@ CurlHttp& CurlHttp::operator=(CurlHttp&&) noexcept = default;
 
 Task<Response<>> CurlHttp::Fetch(Request<> request,
                                  stdx::stop_token stop_token) const {
+  if (RateLimiter* rate_limiter = d_->impl.config().rate_limiter) {
+    co_await rate_limiter->Acquire(/*count=*/1, stop_token);
+  }
   auto response =
       co_await d_->impl.Fetch(std::move(request), std::move(stop_token));
   auto status = response->status;
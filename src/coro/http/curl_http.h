@@ -2,15 +2,24 @@
 #define CORO_HTTP_SRC_CORO_HTTP_CURL_HTTP_H_
 
 #include "coro/http/http.h"
+#include "coro/rate_limiter.h"
 #include "coro/util/event_loop.h"
+#include "coro/util/thread_pool.h"
 
 namespace coro::http {
 
 std::string GetNativeCaCertBlob();
 
+// Reads the native CA bundle on `thread_pool`, without blocking the event loop.
+Task<std::string> GetNativeCaCertBlob(util::ThreadPool* thread_pool,
+                                      stdx::stop_token = stdx::stop_token());
+
 struct CurlHttpConfig {
   std::optional<std::string> alt_svc_path;
   std::optional<std::string> ca_cert_blob = GetNativeCaCertBlob();
+  // If set, every Fetch takes a token from it before the request is started.
+  // It has to outlive CurlHttp and belong to the same event loop.
+  RateLimiter* rate_limiter = nullptr;
 };
 
 class CurlHttp {
@@ -328,4 +328,12 @@ TcpServer CreateHttpServer(HttpHandler http_handler,
                    event_loop, config);
 }
 
+TcpServer CreateHttpServer(HttpHandler http_handler,
+                           const EventLoop* event_loop,
+                           const coro::util::EventLoopGroup* group,
+                           const TcpServer::Config& config) {
+  return TcpServer(HttpHandlerT{.http_handler = std::move(http_handler)},
+                   event_loop, group, config);
+}
+
 }  // namespace coro::http
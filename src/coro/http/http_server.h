@@ -10,12 +10,20 @@
 namespace coro::http {
 
 using HttpHandler =
-    stdx::any_invocable<Task<Response<>>(Request<>, stdx::stop_token)>;
+    stdx::any_invocable<Task<Response<>>(Request<>, stdx::stop_token),
+                        stdx::any_invocable_hot_path_buffer_size>;
 
 coro::util::TcpServer CreateHttpServer(
     HttpHandler http_handler, const coro::util::EventLoop* event_loop,
     const coro::util::TcpServer::Config& config);
 
+// Serves the connections on the event loops of `group`, `http_handler` has to
+// be safe to call concurrently.
+coro::util::TcpServer CreateHttpServer(
+    HttpHandler http_handler, const coro::util::EventLoop* event_loop,
+    const coro::util::EventLoopGroup* group,
+    const coro::util::TcpServer::Config& config);
+
 }  // namespace coro::http
 
 #endif  // CORO_HTTP_HTTP_SERVER_H
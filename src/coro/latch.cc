@@ -0,0 +1,167 @@
+#include "coro/latch.h"
+
+#include <utility>
+
+#include "coro/interrupted_exception.h"
+
+namespace coro {
+
+Latch::Latch(int64_t count) : count_(count) {}
+
+void Latch::CountDown(int64_t count) {
+  if (count_ == 0) {
+    return;
+  }
+  count_ = count_ > count ? count_ - count : 0;
+  if (count_ == 0) {
+    // Waiters are unlinked one by one right before being resumed, so
+    // cancelling any of the remaining ones from a resumed coroutine is a
+    // no-op.
+    util::IntrusiveList<WaitTask> waiters;
+    waiters.Splice(waiters_);
+    while (WaitTask* waiter = waiters.PopFront()) {
+      std::exchange(waiter->handle_, nullptr).resume();
+    }
+  }
+}
+
+Latch::WaitTask Latch::Wait(stdx::stop_token stop_token) {
+  return WaitTask(this, /*arrive_count=*/0, std::move(stop_token));
+}
+
+Latch::WaitTask Latch::ArriveAndWait(int64_t count,
+                                     stdx::stop_token stop_token) {
+  return WaitTask(this, count, std::move(stop_token));
+}
+
+Latch::WaitTask::WaitTask(Latch* latch, int64_t arrive_count,
+                          stdx::stop_token stop_token)
+    : latch_(latch),
+      arrive_count_(arrive_count),
+      stop_callback_(std::move(stop_token), OnCancel{this}) {}
+
+Latch::WaitTask::~WaitTask() {
+  if (latch_->waiters_.Contains(this)) {
+    latch_->waiters_.Remove(this);
+  }
+}
+
+bool Latch::WaitTask::await_ready() {
+  if (arrive_count_ > 0) {
+    latch_->CountDown(arrive_count_);
+  }
+  if (latch_->TryWait()) {
+    interrupted_ = false;
+    return true;
+  }
+  return interrupted_;
+}
+
+void Latch::WaitTask::await_suspend(stdx::coroutine_handle<void> handle) {
+  handle_ = handle;
+  latch_->waiters_.PushBack(this);
+}
+
+void Latch::WaitTask::await_resume() const {
+  if (interrupted_) {
+    throw InterruptedException();
+  }
+}
+
+Expected<void> Latch::WaitTask::await_resume_expected() const {
+  if (interrupted_) {
+    return Unexpected::Interrupted();
+  }
+  return {};
+}
+
+void Latch::WaitTask::OnCancel::operator()() const {
+  if (task->handle_ && !task->latch_->waiters_.Contains(task)) {
+    // Already being resumed by CountDown.
+    return;
+  }
+  task->interrupted_ = true;
+  if (task->handle_) {
+    task->latch_->waiters_.Remove(task);
+    std::exchange(task->handle_, nullptr).resume();
+  }
+}
+
+Barrier::Barrier(int64_t count) : expected_(count), pending_(count) {}
+
+Barrier::WaitTask Barrier::ArriveAndWait(stdx::stop_token stop_token) {
+  return WaitTask(this, std::move(stop_token));
+}
+
+void Barrier::ArriveAndDrop() {
+  expected_--;
+  Arrive();
+}
+
+void Barrier::Arrive() {
+  if (--pending_ > 0) {
+    return;
+  }
+  pending_ = expected_;
+  phase_++;
+  util::IntrusiveList<WaitTask> waiters;
+  waiters.Splice(waiters_);
+  while (WaitTask* waiter = waiters.PopFront()) {
+    std::exchange(waiter->handle_, nullptr).resume();
+  }
+}
+
+Barrier::WaitTask::WaitTask(Barrier* barrier, stdx::stop_token stop_token)
+    : barrier_(barrier),
+      stop_callback_(std::move(stop_token), OnCancel{this}) {}
+
+Barrier::WaitTask::~WaitTask() {
+  if (barrier_->waiters_.Contains(this)) {
+    barrier_->waiters_.Remove(this);
+    barrier_->pending_++;
+  }
+}
+
+bool Barrier::WaitTask::await_ready() {
+  // The last arrival completes the phase even if the stop was requested.
+  if (barrier_->pending_ == 1) {
+    barrier_->Arrive();
+    interrupted_ = false;
+    return true;
+  }
+  return interrupted_;
+}
+
+void Barrier::WaitTask::await_suspend(stdx::coroutine_handle<void> handle) {
+  handle_ = handle;
+  barrier_->waiters_.PushBack(this);
+  barrier_->pending_--;
+}
+
+void Barrier::WaitTask::await_resume() const {
+  if (interrupted_) {
+    throw InterruptedException();
+  }
+}
+
+Expected<void> Barrier::WaitTask::await_resume_expected() const {
+  if (interrupted_) {
+    return Unexpected::Interrupted();
+  }
+  return {};
+}
+
+void Barrier::WaitTask::OnCancel::operator()() const {
+  if (task->handle_ && !task->barrier_->waiters_.Contains(task)) {
+    // Already being resumed by Arrive.
+    return;
+  }
+  task->interrupted_ = true;
+  if (task->handle_) {
+    task->barrier_->waiters_.Remove(task);
+    task->barrier_->pending_++;
+    std::exchange(task->handle_, nullptr).resume();
+  }
+}
+
+}  // namespace coro
@@ -0,0 +1,131 @@
+#ifndef CORO_LATCH_H
+#define CORO_LATCH_H
+
+#include <cstdint>
+
+#include "coro/expected.h"
+#include "coro/stdx/coroutine.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/util/intrusive_list.h"
+
+namespace coro {
+
+// Single use counter; waiters are resumed once it drops to zero. Waiting is
+// allocation free, like with AsyncEvent.
+class Latch {
+ public:
+  class WaitTask;
+
+  explicit Latch(int64_t count);
+  Latch(const Latch&) = delete;
+  Latch(Latch&&) = delete;
+  Latch& operator=(const Latch&) = delete;
+  Latch& operator=(Latch&&) = delete;
+
+  void CountDown(int64_t count = 1);
+  bool TryWait() const { return count_ == 0; }
+  WaitTask Wait(stdx::stop_token stop_token = stdx::stop_token());
+  // Counts down by `count` once awaited.
+  WaitTask ArriveAndWait(int64_t count = 1,
+                         stdx::stop_token stop_token = stdx::stop_token());
+
+ private:
+  int64_t count_;
+  util::IntrusiveList<WaitTask> waiters_;
+};
+
+class Latch::WaitTask : public util::IntrusiveListNode<WaitTask> {
+ public:
+  WaitTask(Latch* latch, int64_t arrive_count, stdx::stop_token stop_token);
+  ~WaitTask();
+
+  WaitTask(const WaitTask&) = delete;
+  WaitTask(WaitTask&&) = delete;
+  WaitTask& operator=(const WaitTask&) = delete;
+  WaitTask& operator=(WaitTask&&) = delete;
+
+  bool await_ready();
+  void await_suspend(stdx::coroutine_handle<void> handle);
+  void await_resume() const;
+  Expected<void> await_resume_expected() const;
+
+ private:
+  friend class Latch;
+
+  struct OnCancel {
+    void operator()() const;
+    WaitTask* task;
+  };
+
+  Latch* latch_;
+  int64_t arrive_count_;
+  stdx::coroutine_handle<void> handle_;
+  bool interrupted_ = false;
+  stdx::stop_callback<OnCancel> stop_callback_;
+};
+
+// Reusable rendezvous point for a fixed set of participants. Once all of them
+// arrived, they are resumed and the next phase starts.
+class Barrier {
+ public:
+  class WaitTask;
+
+  explicit Barrier(int64_t count);
+  Barrier(const Barrier&) = delete;
+  Barrier(Barrier&&) = delete;
+  Barrier& operator=(const Barrier&) = delete;
+  Barrier& operator=(Barrier&&) = delete;
+
+  // If `stop_token` gets stopped before the phase completes, the arrival is
+  // withdrawn and InterruptedException is thrown.
+  WaitTask ArriveAndWait(stdx::stop_token stop_token = stdx::stop_token());
+
+  // Arrives and removes the caller from the participants of the next phases.
+  void ArriveAndDrop();
+
+  uint64_t phase() const { return phase_; }
+
+ private:
+  void Arrive();
+
+  int64_t expected_;
+  int64_t pending_;
+  uint64_t phase_ = 0;
+  util::IntrusiveList<WaitTask> waiters_;
+};
+
+// Arrives once awaited; suspended awaiters count as arrived until they get
+// cancelled or destroyed.
+class Barrier::WaitTask : public util::IntrusiveListNode<WaitTask> {
+ public:
+  WaitTask(Barrier* barrier, stdx::stop_token stop_token);
+  ~WaitTask();
+
+  WaitTask(const WaitTask&) = delete;
+  WaitTask(WaitTask&&) = delete;
+  WaitTask& operator=(const WaitTask&) = delete;
+  WaitTask& operator=(WaitTask&&) = delete;
+
+  bool await_ready();
+  void await_suspend(stdx::coroutine_handle<void> handle);
+  void await_resume() const;
+  Expected<void> await_resume_expected() const;
+
+ private:
+  friend class Barrier;
+
+  struct OnCancel {
+    void operator()() const;
+    WaitTask* task;
+  };
+
+  Barrier* barrier_;
+  stdx::coroutine_handle<void> handle_;
+  bool interrupted_ = false;
+  stdx::stop_callback<OnCancel> stop_callback_;
+};
+
+}  // namespace coro
+
+#endif  // CORO_LATCH_H
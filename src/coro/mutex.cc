@@ -2,6 +2,7 @@
 
 #include <algorithm>
 
+#include "coro/stdx/stop_callback.h"
 #include "coro/util/raii_utils.h"
 
 namespace coro {
@@ -11,21 +12,32 @@ using ::coro::util::AtScopeExit;
 Mutex::Mutex() : locked_() {}
 
 Task<> Mutex::Lock() {
-  if (locked_) {
-    Promise<void> promise;
-    queued_.emplace_back(&promise);
-    auto guard = AtScopeExit([&] {
-      queued_.erase(std::find(queued_.begin(), queued_.end(), &promise));
-    });
-    co_await promise;
+  Waiter waiter;
+  if (LockOrQueue(&waiter)) {
+    co_return;
   }
-  locked_ = true;
+  auto guard = AtScopeExit([&] {
+    if (waiter.linked()) {
+      queued_.Remove(&waiter);
+    }
+  });
+  co_await waiter;
+}
+
+bool Mutex::LockOrQueue(Waiter* waiter) {
+  if (!locked_) {
+    locked_ = true;
+    return true;
+  }
+  queued_.PushBack(waiter);
+  return false;
 }
 
 void Mutex::Unlock() {
-  locked_ = false;
-  if (!queued_.empty()) {
-    queued_.front()->SetValue();
+  if (Waiter* waiter = queued_.PopFront()) {
+    waiter->handle.resume();
+  } else {
+    locked_ = false;
   }
 }
 
@@ -50,54 +62,113 @@ Task<UniqueLock> UniqueLock::Create(Mutex* mutex) {
   co_return UniqueLock(mutex);
 }
 
-ReadWriteMutex::ReadWriteMutex() : reader_count_(), writer_count_() {}
+ReadWriteMutex::ReadWriteMutex(ReadWriteMutexPolicy policy)
+    : policy_(policy), reader_count_(), writer_active_() {}
 
-Task<> ReadWriteMutex::ReadLock() {
-  if (writer_count_ > 0) {
-    Promise<void> promise;
-    queued_readers_.emplace_back(&promise);
-    auto guard = AtScopeExit([&] {
-      queued_readers_.erase(
-          std::find(queued_readers_.begin(), queued_readers_.end(), &promise));
-    });
-    co_await promise;
+Task<> ReadWriteMutex::ReadLock(stdx::stop_token stop_token) {
+  stats_.read_lock_count++;
+  if (CanReadLock()) {
+    reader_count_++;
+    co_return;
   }
-  reader_count_++;
+  stats_.contended_read_lock_count++;
+  Waiter waiter;
+  queued_readers_.PushBack(&waiter);
+  auto guard = AtScopeExit([&] {
+    if (queued_readers_.Contains(&waiter)) {
+      queued_readers_.Remove(&waiter);
+    }
+  });
+  stdx::stop_callback stop_callback(std::move(stop_token), [&] {
+    if (queued_readers_.Contains(&waiter)) {
+      queued_readers_.Remove(&waiter);
+      waiter.promise.SetInterrupted();
+    }
+  });
+  co_await waiter.promise;
 }
 
 void ReadWriteMutex::ReadUnlock() {
   reader_count_--;
   if (reader_count_ == 0 && !queued_writers_.empty()) {
-    queued_writers_.front()->SetValue();
+    AdmitWriter();
   }
 }
 
-Task<> ReadWriteMutex::WriteLock() {
-  if (reader_count_ > 0) {
-    Promise<void> promise;
-    queued_writers_.emplace_back(&promise);
-    auto guard = AtScopeExit([&] {
-      queued_writers_.erase(
-          std::find(queued_writers_.begin(), queued_writers_.end(), &promise));
-    });
-    co_await promise;
+Task<> ReadWriteMutex::WriteLock(stdx::stop_token stop_token) {
+  stats_.write_lock_count++;
+  if (!writer_active_ && reader_count_ == 0 && queued_writers_.empty()) {
+    writer_active_ = true;
+    co_return;
   }
-  writer_count_++;
+  stats_.contended_write_lock_count++;
+  Waiter waiter;
+  queued_writers_.PushBack(&waiter);
+  auto guard = AtScopeExit([&] {
+    if (queued_writers_.Contains(&waiter)) {
+      queued_writers_.Remove(&waiter);
+    }
+  });
+  stdx::stop_callback stop_callback(std::move(stop_token), [&] {
+    if (queued_writers_.Contains(&waiter)) {
+      queued_writers_.Remove(&waiter);
+      // Readers might have been held back only by this writer.
+      if (CanReadLock()) {
+        AdmitReaders();
+      }
+      waiter.promise.SetInterrupted();
+    }
+  });
+  co_await waiter.promise;
 }
 
 void ReadWriteMutex::WriteUnlock() {
-  writer_count_--;
-  if (writer_count_ == 0) {
+  writer_active_ = false;
+  if (policy_ == ReadWriteMutexPolicy::kWriterPreferring) {
     if (!queued_writers_.empty()) {
-      queued_writers_.front()->SetValue();
+      AdmitWriter();
     } else {
-      while (writer_count_ == 0 && !queued_readers_.empty()) {
-        queued_readers_.front()->SetValue();
-      }
+      AdmitReaders();
     }
+  } else {
+    if (!queued_readers_.empty()) {
+      AdmitReaders();
+    } else if (!queued_writers_.empty()) {
+      AdmitWriter();
+    }
+  }
+}
+
+bool ReadWriteMutex::CanReadLock() const {
+  if (writer_active_) {
+    return false;
+  }
+  return policy_ == ReadWriteMutexPolicy::kReaderPreferring ||
+         queued_writers_.empty();
+}
+
+void ReadWriteMutex::AdmitReaders() {
+  if (queued_readers_.empty()) {
+    return;
+  }
+  util::IntrusiveList<Waiter> batch;
+  batch.Splice(queued_readers_);
+  // The whole batch holds the lock before any of the readers runs, so that a
+  // reader unlocking right away doesn't hand the lock to a writer.
+  reader_count_ += batch.size();
+  stats_.reader_batch_count++;
+  stats_.max_reader_batch_size =
+      std::max<uint64_t>(stats_.max_reader_batch_size, batch.size());
+  while (Waiter* waiter = batch.PopFront()) {
+    waiter->promise.SetValue();
   }
 }
 
+void ReadWriteMutex::AdmitWriter() {
+  writer_active_ = true;
+  queued_writers_.PopFront()->promise.SetValue();
+}
+
 ReadLock::ReadLock(ReadWriteMutex* mutex) : mutex_(mutex) {}
 
 ReadLock::ReadLock(ReadLock&& other) noexcept
@@ -108,8 +179,9 @@ ReadLock& ReadLock::operator=(ReadLock&& other) noexcept {
   return *this;
 }
 
-Task<ReadLock> ReadLock::Create(ReadWriteMutex* mutex) {
-  co_await mutex->ReadLock();
+Task<ReadLock> ReadLock::Create(ReadWriteMutex* mutex,
+                                stdx::stop_token stop_token) {
+  co_await mutex->ReadLock(std::move(stop_token));
   co_return ReadLock(mutex);
 }
 
@@ -133,8 +205,9 @@ WriteLock::~WriteLock() noexcept {
   }
 }
 
-Task<WriteLock> WriteLock::Create(ReadWriteMutex* mutex) {
-  co_await mutex->WriteLock();
+Task<WriteLock> WriteLock::Create(ReadWriteMutex* mutex,
+                                  stdx::stop_token stop_token) {
+  co_await mutex->WriteLock(std::move(stop_token));
   co_return WriteLock(mutex);
 }
 
@@ -1,13 +1,17 @@
 #ifndef CORO_MUTEX_H
 #define CORO_MUTEX_H
 
-#include <vector>
+#include <cstdint>
 
 #include "coro/promise.h"
+#include "coro/stdx/coroutine.h"
+#include "coro/stdx/stop_token.h"
 #include "coro/task.h"
+#include "coro/util/intrusive_list.h"
 
 namespace coro {
 
+// Lock ownership is handed over to waiters directly, in FIFO order.
 class Mutex {
  public:
   Mutex();
@@ -20,8 +24,23 @@ class Mutex {
   void Unlock();
 
  private:
+  friend class AsyncConditionVariable;
+
+  // Awaiting it suspends the coroutine until Unlock resumes it.
+  struct Waiter : util::IntrusiveListNode<Waiter> {
+    bool await_ready() const { return false; }
+    void await_suspend(stdx::coroutine_handle<void> h) { handle = h; }
+    void await_resume() const {}
+
+    stdx::coroutine_handle<void> handle;
+  };
+
+  // Takes the lock and returns true if it's free, otherwise queues `waiter`
+  // to be resumed once it gets the lock.
+  bool LockOrQueue(Waiter* waiter);
+
   bool locked_;
-  std::vector<Promise<void>*> queued_;
+  util::IntrusiveList<Waiter> queued_;
 };
 
 class UniqueLock {
@@ -35,31 +54,78 @@ class UniqueLock {
 
   static Task<UniqueLock> Create(Mutex*);
 
+  Mutex* mutex() const { return mutex_; }
+
  private:
   explicit UniqueLock(Mutex*);
 
   Mutex* mutex_;
 };
 
+enum class ReadWriteMutexPolicy {
+  // Readers are let in whenever no writer holds the lock. Writers may starve
+  // under a steady stream of readers.
+  kReaderPreferring,
+  // Queued writers go first, readers are let in only when no writer is queued.
+  // Readers may starve under a steady stream of writers.
+  kWriterPreferring,
+  // Reads and writes alternate: readers arriving while a writer is queued wait
+  // for the next read phase, which admits all of them at once after the
+  // writer.
+  kPhaseFair,
+};
+
+struct ReadWriteMutexStats {
+  uint64_t read_lock_count = 0;
+  uint64_t write_lock_count = 0;
+  // Number of lock acquisitions which had to wait.
+  uint64_t contended_read_lock_count = 0;
+  uint64_t contended_write_lock_count = 0;
+  // Number of times queued readers were admitted together and the size of the
+  // largest such batch.
+  uint64_t reader_batch_count = 0;
+  uint64_t max_reader_batch_size = 0;
+};
+
+// Lock ownership is handed over to waiters directly, so a woken waiter never
+// has to compete for the lock again.
 class ReadWriteMutex {
  public:
-  ReadWriteMutex();
+  explicit ReadWriteMutex(
+      ReadWriteMutexPolicy policy = ReadWriteMutexPolicy::kPhaseFair);
   ReadWriteMutex(const ReadWriteMutex&) = delete;
   ReadWriteMutex(ReadWriteMutex&&) = delete;
   ReadWriteMutex& operator=(const ReadWriteMutex&) = delete;
   ReadWriteMutex& operator=(ReadWriteMutex&&) = delete;
 
-  Task<> ReadLock();
+  // Both throw InterruptedException if `stop_token` gets stopped before the
+  // lock was acquired.
+  Task<> ReadLock(stdx::stop_token stop_token = stdx::stop_token());
   void ReadUnlock();
 
-  Task<> WriteLock();
+  Task<> WriteLock(stdx::stop_token stop_token = stdx::stop_token());
   void WriteUnlock();
 
+  ReadWriteMutexPolicy policy() const { return policy_; }
+  size_t queued_reader_count() const { return queued_readers_.size(); }
+  size_t queued_writer_count() const { return queued_writers_.size(); }
+  const ReadWriteMutexStats& stats() const { return stats_; }
+
  private:
-  int reader_count_;
-  std::vector<Promise<void>*> queued_readers_;
-  int writer_count_;
-  std::vector<Promise<void>*> queued_writers_;
+  struct Waiter : util::IntrusiveListNode<Waiter> {
+    Promise<void> promise;
+  };
+
+  bool CanReadLock() const;
+  void AdmitReaders();
+  void AdmitWriter();
+
+  ReadWriteMutexPolicy policy_;
+  int64_t reader_count_;
+  bool writer_active_;
+  util::IntrusiveList<Waiter> queued_readers_;
+  util::IntrusiveList<Waiter> queued_writers_;
+  ReadWriteMutexStats stats_;
 };
 
 class ReadLock {
@@ -71,7 +137,8 @@ class ReadLock {
 
   ~ReadLock() noexcept;
 
-  static Task<ReadLock> Create(ReadWriteMutex*);
+  static Task<ReadLock> Create(
+      ReadWriteMutex*, stdx::stop_token stop_token = stdx::stop_token());
 
  private:
   explicit ReadLock(ReadWriteMutex* mutex);
@@ -88,7 +155,8 @@ class WriteLock {
 
   ~WriteLock() noexcept;
 
-  static Task<WriteLock> Create(ReadWriteMutex*);
+  static Task<WriteLock> Create(
+      ReadWriteMutex*, stdx::stop_token stop_token = stdx::stop_token());
 
  private:
   explicit WriteLock(ReadWriteMutex* mutex);
@@ -5,6 +5,7 @@
 #include <utility>
 #include <variant>
 
+#include "coro/expected.h"
 #include "coro/stdx/coroutine.h"
 
 namespace coro {
@@ -32,8 +33,14 @@ class Promise {
     continuation_ = continuation;
   }
   T await_resume() {
-    if (std::holds_alternative<std::exception_ptr>(*result_)) {
-      std::rethrow_exception(std::get<std::exception_ptr>(*result_));
+    if (auto* exception = std::get_if<std::exception_ptr>(&*result_)) {
+      Unexpected(*exception).Rethrow();
+    }
+    return std::move(std::get<T>(*result_));
+  }
+  Expected<T> await_resume_expected() {
+    if (auto* exception = std::get_if<std::exception_ptr>(&*result_)) {
+      return Unexpected(*exception);
     }
     return std::move(std::get<T>(*result_));
   }
@@ -56,6 +63,8 @@ class Promise {
       std::exchange(continuation_, nullptr).resume();
     }
   }
+  // Awaiting throws InterruptedException, unless done through AsExpected.
+  void SetInterrupted() { SetException(std::exception_ptr()); }
 
  private:
   std::optional<std::variant<T, std::exception_ptr>> result_;
@@ -85,9 +94,15 @@ class Promise<void> {
     continuation_ = continuation;
   }
   void await_resume() {
-    if (std::holds_alternative<std::exception_ptr>(*result_)) {
-      std::rethrow_exception(std::get<std::exception_ptr>(*result_));
+    if (auto* exception = std::get_if<std::exception_ptr>(&*result_)) {
+      Unexpected(*exception).Rethrow();
+    }
+  }
+  Expected<void> await_resume_expected() {
+    if (auto* exception = std::get_if<std::exception_ptr>(&*result_)) {
+      return Unexpected(*exception);
     }
+    return {};
   }
   void SetValue() {
     result_ = std::monostate();
@@ -105,6 +120,8 @@ class Promise<void> {
       std::exchange(continuation_, nullptr).resume();
     }
   }
+  // Awaiting throws InterruptedException, unless done through AsExpected.
+  void SetInterrupted() { SetException(std::exception_ptr()); }
 
  private:
   std::optional<std::variant<std::monostate, std::exception_ptr>> result_;
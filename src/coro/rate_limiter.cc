@@ -0,0 +1,158 @@
+#include "coro/rate_limiter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "coro/exception.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/util/raii_utils.h"
+
+namespace coro {
+
+using ::coro::util::AtScopeExit;
+
+RateLimiter::RateLimiter(const util::EventLoop* event_loop, Config config)
+    : event_loop_(event_loop),
+      config_(config),
+      tokens_(static_cast<double>(config.burst)),
+      last_refill_(Clock::now()) {
+  if (config_.rate <= 0 || config_.burst <= 0) {
+    throw InvalidArgument("rate limiter needs a positive rate and burst");
+  }
+}
+
+RateLimiter::~RateLimiter() { CancelTimer(); }
+
+Task<> RateLimiter::Acquire(int64_t count, stdx::stop_token stop_token) {
+  if (count <= 0) {
+    throw InvalidArgument("token count has to be positive");
+  }
+  if (count > config_.burst) {
+    throw InvalidArgument("requested more tokens than the burst");
+  }
+  if (TryAcquire(count)) {
+    co_return;
+  }
+  Waiter waiter;
+  waiter.count = count;
+  waiters_.PushBack(&waiter);
+  auto guard = AtScopeExit([&] {
+    if (waiters_.Contains(&waiter)) {
+      waiters_.Remove(&waiter);
+    }
+  });
+  stdx::stop_callback stop_callback(std::move(stop_token), [&] {
+    if (waiters_.Contains(&waiter)) {
+      bool first = waiters_.front() == &waiter;
+      waiters_.Remove(&waiter);
+      if (first) {
+        // The next waiter may need fewer tokens.
+        Update();
+      }
+      // Resumes the awaiting coroutine inline, which destroys `waiter`.
+      waiter.promise.SetInterrupted();
+    }
+  });
+  if (waiters_.front() == &waiter) {
+    ScheduleTimer();
+  }
+  co_await waiter.promise;
+}
+
+bool RateLimiter::TryAcquire(int64_t count) {
+  if (count <= 0) {
+    throw InvalidArgument("token count has to be positive");
+  }
+  Refill();
+  if (waiters_.empty() && tokens_ >= count) {
+    tokens_ -= count;
+    return true;
+  }
+  return false;
+}
+
+double RateLimiter::available() {
+  Refill();
+  return tokens_;
+}
+
+void RateLimiter::Refill() {
+  auto now = Clock::now();
+  std::chrono::duration<double> elapsed = now - last_refill_;
+  tokens_ = std::min(tokens_ + elapsed.count() * config_.rate,
+                     static_cast<double>(config_.burst));
+  last_refill_ = now;
+}
+
+void RateLimiter::Update() {
+  Refill();
+  // Resumed waiters may reenter, so the front is looked up anew every time.
+  while (!waiters_.empty() && tokens_ >= waiters_.front()->count) {
+    Waiter* waiter = waiters_.PopFront();
+    tokens_ -= waiter->count;
+    waiter->promise.SetValue();
+  }
+  ScheduleTimer();
+}
+
+void RateLimiter::ScheduleTimer() {
+  if (waiters_.empty()) {
+    CancelTimer();
+    return;
+  }
+  double missing = waiters_.front()->count - tokens_;
+  int msec = std::max(0, static_cast<int>(
+                             std::ceil(missing / config_.rate * 1000)));
+  auto deadline = Clock::now() + std::chrono::milliseconds(msec);
+  if (timer_ && timer_deadline_ <= deadline) {
+    return;
+  }
+  CancelTimer();
+  timer_.emplace();
+  timer_deadline_ = deadline;
+  RunTask(RunTimer(msec, timer_->get_token()));
+}
+
+void RateLimiter::CancelTimer() {
+  if (timer_) {
+    stdx::stop_source timer = std::move(*timer_);
+    timer_.reset();
+    timer.request_stop();
+  }
+}
+
+Task<> RateLimiter::RunTimer(int msec, stdx::stop_token stop_token) {
+  co_await event_loop_->Wait(msec, std::move(stop_token));
+  timer_.reset();
+  Update();
+}
+
+ShardedRateLimiter::ShardedRateLimiter(
+    const std::vector<const util::EventLoop*>& event_loops,
+    RateLimiter::Config config)
+    : event_loops_(event_loops) {
+  if (event_loops_.empty()) {
+    throw InvalidArgument("sharded rate limiter needs an event loop");
+  }
+  auto shard_count = static_cast<int64_t>(event_loops_.size());
+  if (config.burst < shard_count) {
+    throw InvalidArgument("sharded rate limiter needs a burst of at least "
+                          "one token per event loop");
+  }
+  RateLimiter::Config shard_config{.rate = config.rate / shard_count,
+                                   .burst = config.burst / shard_count};
+  for (const util::EventLoop* event_loop : event_loops_) {
+    shards_.push_back(std::make_unique<RateLimiter>(event_loop, shard_config));
+  }
+}
+
+RateLimiter& ShardedRateLimiter::shard(const util::EventLoop* event_loop) {
+  auto it = std::find(event_loops_.begin(), event_loops_.end(), event_loop);
+  if (it == event_loops_.end()) {
+    throw InvalidArgument("unknown event loop");
+  }
+  return *shards_[it - event_loops_.begin()];
+}
+
+}  // namespace coro
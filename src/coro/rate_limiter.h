@@ -0,0 +1,102 @@
+#ifndef CORO_RATE_LIMITER_H
+#define CORO_RATE_LIMITER_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "coro/promise.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+#include "coro/util/event_loop.h"
+#include "coro/util/intrusive_list.h"
+
+namespace coro {
+
+// Token bucket. Tokens are added continuously at `rate` per second up to
+// `burst`. Waiters are served in FIFO order; while any of them is queued, a
+// single event loop timer is pending for the moment the first one can be
+// served, nothing polls.
+class RateLimiter {
+ public:
+  struct Config {
+    double rate;
+    int64_t burst;
+  };
+
+  RateLimiter(const util::EventLoop* event_loop, Config config);
+  ~RateLimiter();
+
+  RateLimiter(const RateLimiter&) = delete;
+  RateLimiter(RateLimiter&&) = delete;
+  RateLimiter& operator=(const RateLimiter&) = delete;
+  RateLimiter& operator=(RateLimiter&&) = delete;
+
+  // Throws InvalidArgument if `count` isn't positive or exceeds the burst,
+  // InterruptedException if `stop_token` gets stopped before the tokens were
+  // granted, in which case none are consumed.
+  Task<> Acquire(int64_t count = 1,
+                 stdx::stop_token stop_token = stdx::stop_token());
+  // Throws InvalidArgument if `count` isn't positive.
+  bool TryAcquire(int64_t count = 1);
+
+  double available();
+  size_t waiter_count() const { return waiters_.size(); }
+  const Config& config() const { return config_; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Waiter : util::IntrusiveListNode<Waiter> {
+    int64_t count;
+    Promise<void> promise;
+  };
+
+  void Refill();
+  void Update();
+  void ScheduleTimer();
+  void CancelTimer();
+  Task<> RunTimer(int msec, stdx::stop_token stop_token);
+
+  const util::EventLoop* event_loop_;
+  Config config_;
+  double tokens_;
+  Clock::time_point last_refill_;
+  util::IntrusiveList<Waiter> waiters_;
+  std::optional<stdx::stop_source> timer_;
+  Clock::time_point timer_deadline_;
+};
+
+// RateLimiter for use from several event loops. The rate and the burst are
+// split evenly between per event loop shards, so no state is shared across
+// threads. A shard gets `burst / event_loops.size()` tokens, rounded down,
+// and can't lend any from the others: with a burst of 8 over 4 event loops,
+// Acquire(3) throws even though 3 tokens fit into the total burst.
+class ShardedRateLimiter {
+ public:
+  // Throws InvalidArgument if the burst can't give every shard a token.
+  ShardedRateLimiter(const std::vector<const util::EventLoop*>& event_loops,
+                     RateLimiter::Config config);
+
+  // Has to be called on `event_loop`, which must be one of the event loops the
+  // limiter was created with.
+  RateLimiter& shard(const util::EventLoop* event_loop);
+
+  // Like RateLimiter::Acquire on the shard of `event_loop`, so `count` is
+  // limited by the burst of the shard, not the total one.
+  Task<> Acquire(const util::EventLoop* event_loop, int64_t count = 1,
+                 stdx::stop_token stop_token = stdx::stop_token()) {
+    return shard(event_loop).Acquire(count, std::move(stop_token));
+  }
+
+ private:
+  std::vector<const util::EventLoop*> event_loops_;
+  std::vector<std::unique_ptr<RateLimiter>> shards_;
+};
+
+}  // namespace coro
+
+#endif  // CORO_RATE_LIMITER_H
@@ -216,4 +216,13 @@ coro::util::TcpServer CreateRpcServer(
       RpcHandlerT{.rpc_handler = std::move(rpc_handler)}, event_loop, config);
 }
 
+coro::util::TcpServer CreateRpcServer(
+    RpcHandler rpc_handler, const coro::util::EventLoop* event_loop,
+    const coro::util::EventLoopGroup* group,
+    const coro::util::TcpServer::Config& config) {
+  return coro::util::TcpServer(
+      RpcHandlerT{.rpc_handler = std::move(rpc_handler)}, event_loop, group,
+      config);
+}
+
 }  // namespace coro::rpc
\ No newline at end of file
@@ -115,6 +115,11 @@ coro::util::TcpServer CreateRpcServer(
     RpcHandler rpc_handler, const coro::util::EventLoop* event_loop,
     const coro::util::TcpServer::Config& config);
 
+coro::util::TcpServer CreateRpcServer(
+    RpcHandler rpc_handler, const coro::util::EventLoop* event_loop,
+    const coro::util::EventLoopGroup* group,
+    const coro::util::TcpServer::Config& config);
+
 }  // namespace coro::rpc
 
 #endif  // CORO_RPC_RPC_SERVER_H
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "coro/semaphore.h"
+
+#include <utility>
+
+#include "coro/interrupted_exception.h"
+
+namespace coro {
+
+Semaphore::Semaphore(int64_t count) : count_(count) {}
+
+Semaphore::AcquireTask Semaphore::Acquire(stdx::stop_token stop_token) {
+  return AcquireTask(this, std::move(stop_token));
+}
+
+bool Semaphore::TryAcquire() {
+  if (count_ > 0 && waiters_.empty()) {
+    count_--;
+    return true;
+  }
+  return false;
+}
+
+void Semaphore::Release(int64_t count) {
+  count_ += count;
+  while (count_ > 0 && !waiters_.empty()) {
+    count_--;
+    std::exchange(waiters_.PopFront()->handle_, nullptr).resume();
+  }
+}
+
+Semaphore::AcquireTask::AcquireTask(Semaphore* semaphore,
+                                    stdx::stop_token stop_token)
+    : semaphore_(semaphore),
+      stop_callback_(std::move(stop_token), OnCancel{this}) {}
+
+Semaphore::AcquireTask::~AcquireTask() {
+  if (semaphore_->waiters_.Contains(this)) {
+    semaphore_->waiters_.Remove(this);
+  }
+}
+
+bool Semaphore::AcquireTask::await_ready() {
+  // A permit which is available right away is taken even if the stop was
+  // already requested.
+  if (semaphore_->TryAcquire()) {
+    interrupted_ = false;
+    return true;
+  }
+  return interrupted_;
+}
+
+void Semaphore::AcquireTask::await_suspend(
+    stdx::coroutine_handle<void> handle) {
+  handle_ = handle;
+  semaphore_->waiters_.PushBack(this);
+}
+
+void Semaphore::AcquireTask::await_resume() const {
+  if (interrupted_) {
+    throw InterruptedException();
+  }
+}
+
+Expected<void> Semaphore::AcquireTask::await_resume_expected() const {
+  if (interrupted_) {
+    return Unexpected::Interrupted();
+  }
+  return {};
+}
+
+void Semaphore::AcquireTask::OnCancel::operator()() const {
+  if (task->handle_ && !task->semaphore_->waiters_.Contains(task)) {
+    // Already granted a permit by Release.
+    return;
+  }
+  task->interrupted_ = true;
+  if (task->handle_) {
+    task->semaphore_->waiters_.Remove(task);
+    std::exchange(task->handle_, nullptr).resume();
+  }
+}
+
+SemaphoreGuard::SemaphoreGuard(Semaphore* semaphore) : semaphore_(semaphore) {}
+
+SemaphoreGuard::SemaphoreGuard(SemaphoreGuard&& other) noexcept
+    : semaphore_(std::exchange(other.semaphore_, nullptr)) {}
+
+SemaphoreGuard& SemaphoreGuard::operator=(SemaphoreGuard&& other) noexcept {
+  if (semaphore_) {
+    semaphore_->Release();
+  }
+  semaphore_ = std::exchange(other.semaphore_, nullptr);
+  return *this;
+}
+
+SemaphoreGuard::~SemaphoreGuard() noexcept {
+  if (semaphore_) {
+    semaphore_->Release();
+  }
+}
+
+Task<SemaphoreGuard> SemaphoreGuard::Create(Semaphore* semaphore,
+                                            stdx::stop_token stop_token) {
+  co_await semaphore->Acquire(std::move(stop_token));
+  co_return SemaphoreGuard(semaphore);
+}
+
+}  // namespace coro
@@ -0,0 +1,92 @@
+#ifndef CORO_SEMAPHORE_H
+#define CORO_SEMAPHORE_H
+
+#include <cstdint>
+
+#include "coro/expected.h"
+#include "coro/stdx/coroutine.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+#include "coro/util/intrusive_list.h"
+
+namespace coro {
+
+// Counting semaphore. Waiters are granted permits in FIFO order, a permit
+// released while there are waiters is handed over directly to the first one.
+// Acquiring is allocation free: the awaiter returned by Acquire is the node
+// of the waiter list.
+class Semaphore {
+ public:
+  class AcquireTask;
+
+  explicit Semaphore(int64_t count);
+  Semaphore(const Semaphore&) = delete;
+  Semaphore(Semaphore&&) = delete;
+  Semaphore& operator=(const Semaphore&) = delete;
+  Semaphore& operator=(Semaphore&&) = delete;
+
+  // Throws InterruptedException if `stop_token` gets stopped before a permit
+  // was granted, in which case no permit is consumed.
+  AcquireTask Acquire(stdx::stop_token stop_token = stdx::stop_token());
+  bool TryAcquire();
+  void Release(int64_t count = 1);
+
+  int64_t available() const { return count_; }
+  size_t waiter_count() const { return waiters_.size(); }
+
+ private:
+  int64_t count_;
+  util::IntrusiveList<AcquireTask> waiters_;
+};
+
+class Semaphore::AcquireTask : public util::IntrusiveListNode<AcquireTask> {
+ public:
+  AcquireTask(Semaphore* semaphore, stdx::stop_token stop_token);
+  ~AcquireTask();
+
+  AcquireTask(const AcquireTask&) = delete;
+  AcquireTask(AcquireTask&&) = delete;
+  AcquireTask& operator=(const AcquireTask&) = delete;
+  AcquireTask& operator=(AcquireTask&&) = delete;
+
+  bool await_ready();
+  void await_suspend(stdx::coroutine_handle<void> handle);
+  void await_resume() const;
+  Expected<void> await_resume_expected() const;
+
+ private:
+  friend class Semaphore;
+
+  struct OnCancel {
+    void operator()() const;
+    AcquireTask* task;
+  };
+
+  Semaphore* semaphore_;
+  stdx::coroutine_handle<void> handle_;
+  bool interrupted_ = false;
+  stdx::stop_callback<OnCancel> stop_callback_;
+};
+
+class SemaphoreGuard {
+ public:
+  SemaphoreGuard(const SemaphoreGuard&) = delete;
+  SemaphoreGuard(SemaphoreGuard&&) noexcept;
+  SemaphoreGuard& operator=(const SemaphoreGuard&) = delete;
+  SemaphoreGuard& operator=(SemaphoreGuard&&) noexcept;
+
+  ~SemaphoreGuard() noexcept;
+
+  static Task<SemaphoreGuard> Create(
+      Semaphore*, stdx::stop_token stop_token = stdx::stop_token());
+
+ private:
+  explicit SemaphoreGuard(Semaphore*);
+
+  Semaphore* semaphore_;
+};
+
+}  // namespace coro
+
+#endif  // CORO_SEMAPHORE_H
@@ -2,29 +2,45 @@
 #define CORO_UTIL_SHARED_PROMISE_H
 
 #include <functional>
-#include <unordered_set>
+#include <mutex>
 #include <utility>
 #include <variant>
 
+#include "coro/expected.h"
 #include "coro/interrupted_exception.h"
 #include "coro/promise.h"
 #include "coro/stdx/stop_callback.h"
+#include "coro/task.h"
+#include "coro/util/event_loop.h"
+#include "coro/util/intrusive_list.h"
 #include "coro/util/raii_utils.h"
 
 namespace coro {
 
+// Runs `producer` once, on the first call to Get, and hands its result to all
+// the awaiters.
+//
+// The producer may complete on any thread. Awaiters which passed an EventLoop
+// to Get are resumed on that event loop, the others are resumed inline on the
+// thread which completed the producer.
 template <typename F>
 class SharedPromise {
  public:
   using T = typename decltype(std::declval<F>()())::type;
-  using TaskT = std::conditional_t<
-      std::is_same_v<void, T>, Task<>,
-      Task<std::conditional_t<std::is_reference_v<T>, const T,
-                              std::reference_wrapper<const T>>>>;
+  using ExpectedT = std::conditional_t<
+      std::is_same_v<void, T>, void,
+      std::conditional_t<std::is_reference_v<T>,
+                         std::reference_wrapper<std::remove_reference_t<T>>,
+                         std::reference_wrapper<const T>>>;
+  using TaskT = ValueTask<
+      ExpectedT,
+      std::conditional_t<std::is_reference_v<T>, T, ExpectedT>>;
+  using ExpectedTaskT = Task<Expected<ExpectedT>>;
 
   explicit SharedPromise(F producer)
-      : shared_data_(std::make_shared<SharedData>(
-            SharedData{.producer = std::move(producer)})) {}
+      : shared_data_(std::make_shared<SharedData>()) {
+    shared_data_->producer.emplace(std::move(producer));
+  }
 
   SharedPromise(const SharedPromise&) = delete;
   SharedPromise(SharedPromise&&) noexcept = default;
@@ -32,17 +48,47 @@ class SharedPromise {
   SharedPromise& operator=(SharedPromise&&) noexcept = default;
 
   TaskT Get(coro::stdx::stop_token stop_token) const {
-    if (shared_data_->producer) {
-      RunTask(ProduceValue, shared_data_,
-              *std::exchange(shared_data_->producer, std::nullopt));
+    return TaskT(GetExpected(std::move(stop_token)));
+  }
+
+  TaskT Get(const util::EventLoop* event_loop,
+            coro::stdx::stop_token stop_token) const {
+    return TaskT(GetExpected(event_loop, std::move(stop_token)));
+  }
+
+  // Like Get, but reports failures, interruption in particular, without
+  // throwing.
+  ExpectedTaskT GetExpected(coro::stdx::stop_token stop_token) const {
+    return GetExpected(nullptr, std::move(stop_token));
+  }
+
+  ExpectedTaskT GetExpected(const util::EventLoop* event_loop,
+                            coro::stdx::stop_token stop_token) const {
+    std::unique_lock lock(shared_data_->mutex);
+    std::optional<F> producer =
+        std::exchange(shared_data_->producer, std::nullopt);
+    lock.unlock();
+    if (producer) {
+      RunTask(ProduceValue, shared_data_, std::move(*producer));
     }
-    return Get(shared_data_, std::move(stop_token));
+    return GetExpected(shared_data_, event_loop, std::move(stop_token));
+  }
+
+  // Number of coroutines currently awaiting the result.
+  size_t waiter_count() const {
+    std::unique_lock lock(shared_data_->mutex);
+    return shared_data_->awaiters.size();
   }
 
  private:
   struct NotReady {};
+  struct Waiter : util::IntrusiveListNode<Waiter> {
+    Promise<void> promise;
+    const util::EventLoop* event_loop;
+  };
   struct SharedData {
-    std::unordered_set<Promise<void>*> awaiters;
+    std::mutex mutex;
+    util::IntrusiveList<Waiter> awaiters;
     std::variant<
         NotReady, std::exception_ptr,
         std::conditional_t<std::is_same_v<T, void>, std::monostate,
@@ -52,47 +98,95 @@ class SharedPromise {
     std::optional<F> producer;
   };
 
-  static TaskT Get(std::shared_ptr<SharedData> shared_data,
-                   coro::stdx::stop_token stop_token) {
-    if (std::holds_alternative<NotReady>(shared_data->result)) {
-      Promise<void> semaphore;
-      shared_data->awaiters.insert(&semaphore);
-      auto guard = coro::util::AtScopeExit(
-          [&] { shared_data->awaiters.erase(&semaphore); });
-      coro::stdx::stop_callback stop_callback(
-          stop_token, [&] { semaphore.SetException(InterruptedException()); });
-      co_await semaphore;
+  static ExpectedTaskT GetExpected(std::shared_ptr<SharedData> shared_data,
+                                   const util::EventLoop* event_loop,
+                                   coro::stdx::stop_token stop_token) {
+    Waiter waiter;
+    waiter.event_loop = event_loop;
+    bool ready;
+    {
+      std::unique_lock lock(shared_data->mutex);
+      ready = !std::holds_alternative<NotReady>(shared_data->result);
+      if (!ready) {
+        shared_data->awaiters.PushBack(&waiter);
+      }
+    }
+    if (!ready) {
+      auto guard = coro::util::AtScopeExit([&] {
+        std::unique_lock lock(shared_data->mutex);
+        if (shared_data->awaiters.Contains(&waiter)) {
+          shared_data->awaiters.Remove(&waiter);
+        }
+      });
+      coro::stdx::stop_callback stop_callback(stop_token, [&] {
+        {
+          std::unique_lock lock(shared_data->mutex);
+          if (!shared_data->awaiters.Contains(&waiter)) {
+            return;
+          }
+          shared_data->awaiters.Remove(&waiter);
+        }
+        Resume(&waiter, /*interrupted=*/true);
+      });
+      if (auto result = co_await AsExpected(waiter.promise); !result) {
+        co_return result.error();
+      }
     }
     if (std::holds_alternative<std::exception_ptr>(shared_data->result)) {
-      std::rethrow_exception(std::get<std::exception_ptr>(shared_data->result));
+      co_return Unexpected(std::get<std::exception_ptr>(shared_data->result));
     }
-    if constexpr (!std::is_same_v<T, void>) {
-      if constexpr (std::is_reference_v<T>) {
-        co_return *std::get<std::remove_reference_t<T>*>(shared_data->result);
-      } else {
-        co_return std::cref(std::get<T>(shared_data->result));
-      }
+    if constexpr (std::is_same_v<T, void>) {
+      co_return Expected<void>();
+    } else if constexpr (std::is_reference_v<T>) {
+      co_return std::ref(
+          *std::get<std::remove_reference_t<T>*>(shared_data->result));
+    } else {
+      co_return std::cref(std::get<T>(shared_data->result));
     }
   }
 
   static Task<> ProduceValue(std::shared_ptr<SharedData> shared_data,
                              F producer) {
+    decltype(shared_data->result) result;
     try {
       if constexpr (std::is_same_v<void, T>) {
         co_await std::move(producer)();
-        shared_data->result = std::monostate();
+        result = std::monostate();
       } else {
         if constexpr (std::is_reference_v<T>) {
-          shared_data->result = &co_await std::move(producer)();
+          result = &co_await std::move(producer)();
         } else {
-          shared_data->result = co_await std::move(producer)();
+          result = co_await std::move(producer)();
         }
       }
     } catch (...) {
-      shared_data->result = std::current_exception();
+      result = std::current_exception();
+    }
+    // Waiters moved to the local list can no longer be cancelled; each of them
+    // is unlinked before it's resumed, so none of them touches the list again.
+    util::IntrusiveList<Waiter> awaiters;
+    {
+      std::unique_lock lock(shared_data->mutex);
+      shared_data->result = std::move(result);
+      awaiters.Splice(shared_data->awaiters);
     }
-    while (!shared_data->awaiters.empty()) {
-      (*shared_data->awaiters.begin())->SetValue();
+    while (Waiter* waiter = awaiters.PopFront()) {
+      Resume(waiter, /*interrupted=*/false);
+    }
+  }
+
+  static void Resume(Waiter* waiter, bool interrupted) {
+    auto resume = [waiter, interrupted] {
+      if (interrupted) {
+        waiter->promise.SetInterrupted();
+      } else {
+        waiter->promise.SetValue();
+      }
+    };
+    if (waiter->event_loop) {
+      waiter->event_loop->RunOnEventLoop(std::move(resume));
+    } else {
+      resume();
     }
   }
 
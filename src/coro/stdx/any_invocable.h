@@ -1,6 +1,8 @@
 #ifndef CORO_HTTP_ANY_INVOCABLE_H
 #define CORO_HTTP_ANY_INVOCABLE_H
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <type_traits>
@@ -44,24 +46,43 @@ namespace std {
 
 namespace coro::stdx {
 
+// Size of the inline buffer of any_invocable<Signature>; callables which don't
+// fit are allocated on the heap.
+inline constexpr std::size_t any_invocable_default_buffer_size =
+    2 * sizeof(void*);
+
+// Inline buffer size for callbacks created on hot paths, large enough for
+// lambdas capturing a handful of pointers and integers.
+inline constexpr std::size_t any_invocable_hot_path_buffer_size =
+    6 * sizeof(void*);
+
 namespace any_detail {
 
-using buffer = std::aligned_storage_t<sizeof(void*) * 2, alignof(void*)>;
+inline thread_local uint64_t heap_allocation_count = 0;
 
-template <class T>
+template <std::size_t BufferSize>
+using buffer = std::aligned_storage_t<BufferSize, alignof(void*)>;
+
+template <class T, std::size_t BufferSize>
 inline constexpr bool is_small_object_v =
-    sizeof(T) <= sizeof(buffer) && alignof(buffer) % alignof(T) == 0 &&
+    sizeof(T) <= sizeof(buffer<BufferSize>) &&
+    alignof(buffer<BufferSize>) % alignof(T) == 0 &&
     std::is_nothrow_move_constructible_v<T>;
 
+template <std::size_t BufferSize>
 union storage {
+  static_assert(BufferSize >= sizeof(void*));
+
   void* ptr_ = nullptr;
-  buffer buf_;
+  buffer<BufferSize> buf_;
 };
 
 enum class action { destroy, move };
 
-template <class R, class... ArgTypes>
+template <class R, std::size_t BufferSize, class... ArgTypes>
 struct handler_traits {
+  using storage = any_detail::storage<BufferSize>;
+
   template <class Derived>
   struct handler_base {
     static void handle(action act, storage* current, storage* other = nullptr) {
@@ -105,6 +126,7 @@ struct handler_traits {
     template <class... Args>
     static void create(storage& s, Args&&... args) {
       s.ptr_ = new T(std::forward<Args>(args)...);
+      heap_allocation_count++;
     }
 
     static void destroy(storage& s) noexcept { delete static_cast<T*>(s.ptr_); }
@@ -120,8 +142,9 @@ struct handler_traits {
   };
 
   template <class T>
-  using handler = std::conditional_t<is_small_object_v<T>, small_handler<T>,
-                                     large_handler<T>>;
+  using handler =
+      std::conditional_t<is_small_object_v<T, BufferSize>, small_handler<T>,
+                         large_handler<T>>;
 };
 
 template <class T>
@@ -133,17 +156,16 @@ struct is_in_place_type<std::in_place_type_t<T>> : std::true_type {};
 template <class T>
 inline constexpr auto is_in_place_type_v = is_in_place_type<T>::value;
 
-template <class R, bool is_noexcept, class... ArgTypes>
+template <class R, bool is_noexcept, std::size_t BufferSize, class... ArgTypes>
 class any_invocable_impl {
   template <class T>
-  using handler =
-      typename any_detail::handler_traits<R, ArgTypes...>::template handler<T>;
+  using handler = typename any_detail::handler_traits<
+      R, BufferSize, ArgTypes...>::template handler<T>;
 
-  using storage = any_detail::storage;
+  using storage = any_detail::storage<BufferSize>;
   using action = any_detail::action;
-  using handle_func = void (*)(any_detail::action, any_detail::storage*,
-                               any_detail::storage*);
-  using call_func = R (*)(const any_detail::storage&, ArgTypes...);
+  using handle_func = void (*)(any_detail::action, storage*, storage*);
+  using call_func = R (*)(const storage&, ArgTypes...);
 
  public:
   using result_type = R;
@@ -249,14 +271,24 @@ using can_convert = std::conjunction<
 
 }  // namespace any_detail
 
-template <class Signature>
+// Number of callables this thread stored in any_invocable on the heap.
+inline uint64_t any_invocable_heap_allocation_count() {
+  return any_detail::heap_allocation_count;
+}
+
+// Unlike std::move_only_function, takes the inline buffer size as an extra
+// template parameter.
+template <class Signature,
+          std::size_t BufferSize = any_invocable_default_buffer_size>
 class any_invocable;
 
 #define __OFATS_ANY_INVOCABLE(cv, ref, noex, inv_quals)                        \
-  template <class R, class... ArgTypes>                                        \
-  class any_invocable<R(ArgTypes...) cv ref noexcept(noex)> final              \
-      : public any_detail::any_invocable_impl<R, noex, ArgTypes...> {          \
-    using base_type = any_detail::any_invocable_impl<R, noex, ArgTypes...>;    \
+  template <class R, std::size_t BufferSize, class... ArgTypes>                \
+  class any_invocable<R(ArgTypes...) cv ref noexcept(noex), BufferSize> final  \
+      : public any_detail::any_invocable_impl<R, noex, BufferSize,             \
+                                              ArgTypes...> {                   \
+    using base_type =                                                          \
+        any_detail::any_invocable_impl<R, noex, BufferSize, ArgTypes...>;      \
                                                                                \
    public:                                                                     \
     using base_type::base_type;                                                \
@@ -1,5 +1,7 @@
 #include "coro/stdx/stacktrace.h"
 
+#include <array>
+#include <atomic>
 #include <sstream>
 
 #ifdef HAVE_BOOST_STACKTRACE
@@ -11,18 +13,42 @@
 
 namespace coro {
 
+namespace {
+
+std::atomic<uint32_t> stacktrace_sample_rate = 1;
+std::atomic<uint64_t> stacktrace_capture_count = 0;
+
+#ifdef HAVE_BOOST_STACKTRACE
+constexpr size_t kMaxFrameCount = 64;
+
+bool ShouldCaptureStacktrace() {
+  uint32_t rate = stacktrace_sample_rate.load(std::memory_order_relaxed);
+  if (rate <= 1) {
+    return rate == 1;
+  }
+  thread_local uint32_t call_count = 0;
+  return call_count++ % rate == 0;
+}
+#endif
+
+}  // namespace
+
 namespace stdx {
 
 struct stacktrace::Impl {
 #ifdef HAVE_BOOST_STACKTRACE
-  boost::stacktrace::stacktrace stacktrace;
+  std::array<boost::stacktrace::frame::native_frame_ptr_t, kMaxFrameCount>
+      frames;
+  size_t frame_count;
 #endif
 };
 
+stacktrace::stacktrace() noexcept = default;
+
 stacktrace::stacktrace(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {}
 
 stacktrace::stacktrace(const stacktrace& other)
-    : impl_(std::make_unique<Impl>(*other.impl_)) {}
+    : impl_(other.impl_ ? std::make_unique<Impl>(*other.impl_) : nullptr) {}
 
 stacktrace::stacktrace(stacktrace&& other) noexcept
     : impl_(std::move(other.impl_)) {}
@@ -30,7 +56,7 @@ stacktrace::stacktrace(stacktrace&& other) noexcept
 stacktrace::~stacktrace() = default;
 
 stacktrace& stacktrace::operator=(const stacktrace& other) {
-  impl_ = std::make_unique<Impl>(*other.impl_);
+  impl_ = other.impl_ ? std::make_unique<Impl>(*other.impl_) : nullptr;
   return *this;
 }
 
@@ -41,7 +67,7 @@ stacktrace& stacktrace::operator=(stacktrace&& other) noexcept {
 
 bool stacktrace::empty() const noexcept {
 #ifdef HAVE_BOOST_STACKTRACE
-  return impl_->stacktrace.empty();
+  return !impl_ || impl_->frame_count == 0;
 #else
   return true;
 #endif
@@ -49,10 +75,18 @@ bool stacktrace::empty() const noexcept {
 
 stacktrace stacktrace::current() noexcept {
 #ifdef HAVE_BOOST_STACKTRACE
-  return stacktrace(std::make_unique<Impl>(
-      Impl{.stacktrace = boost::stacktrace::stacktrace()}));
+  if (!ShouldCaptureStacktrace()) {
+    return stacktrace();
+  }
+  auto impl = std::make_unique<Impl>();
+  // Skips this function; the count includes the terminating null frame.
+  size_t count = boost::stacktrace::safe_dump_to(
+      1, impl->frames.data(), sizeof(impl->frames));
+  impl->frame_count = count > 0 ? count - 1 : 0;
+  stacktrace_capture_count.fetch_add(1, std::memory_order_relaxed);
+  return stacktrace(std::move(impl));
 #else
-  return stacktrace(std::make_unique<Impl>());
+  return stacktrace();
 #endif
 }
 
@@ -61,7 +95,6 @@ stacktrace stacktrace::current() noexcept {
 std::string GetHtmlStacktrace(const stdx::stacktrace& d) {
 #ifdef HAVE_BOOST_STACKTRACE
   std::stringstream stream;
-  boost::stacktrace::stacktrace p;
   std::string stacktrace = ToString(d);
   for (int i = 0; i < stacktrace.size();) {
     if (i + 1 < stacktrace.size() && stacktrace.substr(i, 2) == "\r\n") {
@@ -84,11 +117,28 @@ std::string GetHtmlStacktrace(const stdx::stacktrace& d) {
 
 std::string ToString(const stdx::stacktrace& d) {
 #ifdef HAVE_BOOST_STACKTRACE
-  return boost::stacktrace::to_string(GetImpl(&d)->stacktrace);
+  if (d.empty()) {
+    return "";
+  }
+  const auto* impl = GetImpl(&d);
+  return boost::stacktrace::to_string(boost::stacktrace::stacktrace::from_dump(
+      impl->frames.data(), impl->frame_count * sizeof(impl->frames[0])));
 #else
   (void)d;
   return "";
 #endif
 }
 
+void SetStacktraceSampleRate(uint32_t rate) {
+  stacktrace_sample_rate.store(rate, std::memory_order_relaxed);
+}
+
+uint32_t GetStacktraceSampleRate() {
+  return stacktrace_sample_rate.load(std::memory_order_relaxed);
+}
+
+uint64_t GetStacktraceCaptureCount() {
+  return stacktrace_capture_count.load(std::memory_order_relaxed);
+}
+
 }  // namespace coro
\ No newline at end of file
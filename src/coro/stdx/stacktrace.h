@@ -1,13 +1,17 @@
 #ifndef CORO_STDX_STACKTRACE_H
 #define CORO_STDX_STACKTRACE_H
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
 namespace coro::stdx {
 
+// Holds raw frame addresses only, they get symbolized once converted to a
+// string.
 class stacktrace {
  public:
+  stacktrace() noexcept;
   stacktrace(const stacktrace&);
   stacktrace(stacktrace&&) noexcept;
 
@@ -18,6 +22,8 @@ class stacktrace {
 
   bool empty() const noexcept;
 
+  // Returns an empty stacktrace if capturing is unsupported, disabled or the
+  // call wasn't sampled, see SetStacktraceSampleRate.
   static stacktrace current() noexcept;
 
  private:
@@ -38,6 +44,14 @@ namespace coro {
 std::string GetHtmlStacktrace(const stdx::stacktrace&);
 std::string ToString(const stdx::stacktrace&);
 
+// Makes stdx::stacktrace::current() capture only one out of every `rate` calls
+// on each thread; 0 disables capturing. Defaults to 1.
+void SetStacktraceSampleRate(uint32_t rate);
+uint32_t GetStacktraceSampleRate();
+
+// Number of stack traces captured by all threads so far.
+uint64_t GetStacktraceCaptureCount();
+
 }  // namespace coro
 
 #endif  // CORO_STDX_STACKTRACE_H
\ No newline at end of file
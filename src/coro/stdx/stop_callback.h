@@ -12,20 +12,17 @@ class stop_callback : private internal::base_stop_callback {
   stop_callback(stop_token stop_token, Callable callable)
       : stop_token_(std::move(stop_token)), callable_(std::move(callable)) {
     if (stop_token_.stop_possible()) {
-      if (stop_token_.stop_requested()) {
-        callable_();
+      if (stop_token_.state_->try_add_callback(this)) {
+        registered_ = true;
       } else {
-        stop_token_.state_->stop_callback.insert(this);
+        callable_();
       }
     }
   }
 
   ~stop_callback() {
-    if (stop_token_.stop_possible()) {
-      auto it = stop_token_.state_->stop_callback.find(this);
-      if (it != std::end(stop_token_.state_->stop_callback)) {
-        stop_token_.state_->stop_callback.erase(it);
-      }
+    if (registered_) {
+      stop_token_.state_->remove_callback(this);
     }
   }
 
@@ -40,6 +37,7 @@ class stop_callback : private internal::base_stop_callback {
 
   stop_token stop_token_;
   C callable_;
+  bool registered_ = false;
 };
 
 template <typename C>
@@ -4,25 +4,120 @@
 
 namespace coro::stdx {
 
-stop_source::stop_source()
-    : state_(std::make_shared<internal::stop_source_state>()) {}
+namespace internal {
 
-bool stop_source::request_stop() noexcept {
-  if (!state_) {
+uint32_t stop_source_state::lock() noexcept {
+  uint32_t state = value.load(std::memory_order_relaxed);
+  int spin_count = 0;
+  while (true) {
+    if ((state & kLocked) == 0) {
+      if (value.compare_exchange_weak(state, state | kLocked,
+                                      std::memory_order_acquire,
+                                      std::memory_order_relaxed)) {
+        return state | kLocked;
+      }
+    } else {
+      if (++spin_count > 16) {
+        std::this_thread::yield();
+      }
+      state = value.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void stop_source_state::unlock(uint32_t state) noexcept {
+  value.store(state & ~kLocked, std::memory_order_release);
+}
+
+bool stop_source_state::request_stop() noexcept {
+  uint32_t state = lock();
+  if (state & kStopRequested) {
+    unlock(state);
     return false;
   }
-  state_->stopped = true;
+  state |= kStopRequested;
+  requester = std::this_thread::get_id();
+  while (base_stop_callback* cb = head) {
+    head = cb->next_;
+    if (head) {
+      head->prev_ = &head;
+    }
+    cb->prev_ = nullptr;
+    unlock(state);
 
-  auto state = state_;
-  while (!state->stop_callback.empty()) {
-    auto* cb = *state->stop_callback.begin();
-    state->stop_callback.erase(state->stop_callback.begin());
+    bool destroyed = false;
+    cb->destroyed_ = &destroyed;
     (*cb)();
+    if (!destroyed) {
+      cb->destroyed_ = nullptr;
+      cb->done_.store(true, std::memory_order_release);
+    }
+
+    state = lock();
   }
+  unlock(state);
+  return true;
+}
 
+bool stop_source_state::try_add_callback(base_stop_callback* cb) noexcept {
+  uint32_t state = lock();
+  if (state & kStopRequested) {
+    unlock(state);
+    return false;
+  }
+  cb->next_ = head;
+  if (head) {
+    head->prev_ = &cb->next_;
+  }
+  cb->prev_ = &head;
+  head = cb;
+  unlock(state);
   return true;
 }
 
+void stop_source_state::remove_callback(base_stop_callback* cb) noexcept {
+  uint32_t state = lock();
+  if (cb->prev_) {
+    *cb->prev_ = cb->next_;
+    if (cb->next_) {
+      cb->next_->prev_ = cb->prev_;
+    }
+    unlock(state);
+    return;
+  }
+  bool requested_on_this_thread = requester == std::this_thread::get_id();
+  unlock(state);
+  if (requested_on_this_thread) {
+    // Either the callback destroys itself while running, or it already ran.
+    if (cb->destroyed_) {
+      *cb->destroyed_ = true;
+    }
+    return;
+  }
+  while (!cb->done_.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+}
+
+}  // namespace internal
+
+stop_source::stop_source()
+    : state_(std::make_shared<internal::stop_source_state>()) {}
+
+stop_source::stop_source(std::chrono::steady_clock::time_point deadline)
+    : stop_source() {
+  state_->deadline = deadline;
+}
+
+bool stop_source::request_stop() noexcept {
+  if (!state_) {
+    return false;
+  }
+  // Keeps the state alive in case a callback destroys this stop_source.
+  auto state = state_;
+  return state->request_stop();
+}
+
 stop_token stop_source::get_token() const noexcept {
   return stop_token{state_};
 }
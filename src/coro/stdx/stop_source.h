@@ -1,7 +1,10 @@
 #ifndef CORO_HTTP_STOP_SOURCE_H
 #define CORO_HTTP_STOP_SOURCE_H
 
-#include <unordered_set>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
 
 #include "coro/stdx/stop_token.h"
 
@@ -12,11 +15,49 @@ namespace internal {
 class base_stop_callback {
  public:
   virtual void operator()() = 0;
+
+ private:
+  friend struct stop_source_state;
+
+  base_stop_callback* next_ = nullptr;
+  base_stop_callback** prev_ = nullptr;
+  // Set while the callback runs, lets it detect that it destroyed itself.
+  bool* destroyed_ = nullptr;
+  std::atomic<bool> done_{false};
 };
 
+// Callbacks are kept in an intrusive list, so registering and deregistering
+// them never allocates. The list is guarded by a spin bit packed together with
+// the stop flag into a single atomic word.
 struct stop_source_state {
-  bool stopped = false;
-  std::unordered_set<base_stop_callback*> stop_callback;
+  static constexpr uint32_t kStopRequested = 1;
+  static constexpr uint32_t kLocked = 2;
+
+  bool stop_requested() const noexcept {
+    return (value.load(std::memory_order_acquire) & kStopRequested) != 0;
+  }
+
+  bool request_stop() noexcept;
+
+  // Returns false if stop was already requested, in which case the callback
+  // isn't registered.
+  bool try_add_callback(base_stop_callback*) noexcept;
+
+  // Waits for the callback to finish if it's concurrently running on another
+  // thread.
+  void remove_callback(base_stop_callback*) noexcept;
+
+  std::atomic<uint32_t> value{0};
+  base_stop_callback* head = nullptr;
+  std::thread::id requester;
+  // Immutable, so it's read without the lock.
+  std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::time_point::max();
+
+ private:
+  // Returns the state with the lock acquired.
+  uint32_t lock() noexcept;
+  void unlock(uint32_t state) noexcept;
 };
 
 }  // namespace internal
@@ -24,7 +65,11 @@ struct stop_source_state {
 class stop_source {
  public:
   stop_source();
+  // Extension: the deadline is only carried by the tokens, reaching it
+  // doesn't request a stop by itself.
+  explicit stop_source(std::chrono::steady_clock::time_point deadline);
 
+  // Returns true if this call made the stop request.
   bool request_stop() noexcept;
   [[nodiscard]] stop_token get_token() const noexcept;
 
@@ -7,11 +7,16 @@
 namespace coro::stdx {
 
 bool stop_token::stop_requested() const noexcept {
-  return state_ && state_->stopped;
+  return state_ && state_->stop_requested();
 }
 
 bool stop_token::stop_possible() const noexcept { return state_ != nullptr; }
 
+std::chrono::steady_clock::time_point stop_token::deadline() const noexcept {
+  return state_ ? state_->deadline
+                : std::chrono::steady_clock::time_point::max();
+}
+
 stop_token::stop_token(
     std::shared_ptr<internal::stop_source_state> state) noexcept
     : state_(std::move(state)) {}
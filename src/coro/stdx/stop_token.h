@@ -1,6 +1,7 @@
 #ifndef CORO_HTTP_STOP_TOKEN_H
 #define CORO_HTTP_STOP_TOKEN_H
 
+#include <chrono>
 #include <memory>
 
 namespace coro::stdx {
@@ -16,6 +17,11 @@ class stop_token {
   [[nodiscard]] bool stop_requested() const noexcept;
   [[nodiscard]] bool stop_possible() const noexcept;
 
+  // Extension: the deadline of the stop_source this token came from,
+  // time_point::max() if it has none.
+  [[nodiscard]] std::chrono::steady_clock::time_point deadline()
+      const noexcept;
+
  private:
   friend class stop_source;
   template <typename C>
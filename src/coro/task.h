@@ -8,6 +8,7 @@
 #include "coro/interrupted_exception.h"
 #include "coro/stdx/concepts.h"
 #include "coro/stdx/coroutine.h"
+#include "coro/util/frame_pool.h"
 
 namespace coro {
 
@@ -16,7 +17,7 @@ namespace detail {
 template <typename T>
 class Task;
 
-class TaskPromiseBase {
+class TaskPromiseBase : public util::PooledFrame {
  public:
   TaskPromiseBase() noexcept {}
 
@@ -288,7 +289,7 @@ concept Awaitable =
     };
 
 struct RunTaskT {
-  struct promise_type {
+  struct promise_type : util::PooledFrame {
     auto get_return_object() { return RunTaskT(); }
     stdx::suspend_never initial_suspend() { return {}; }
     stdx::suspend_never final_suspend() noexcept { return {}; }
@@ -305,6 +306,9 @@ inline RunTaskT RunTask(Task<> task) {
 }
 
 template <typename F, typename... Args>
+  requires requires(F func, Args&&... args) {
+    func(std::forward<Args>(args)...);
+  }
 RunTaskT RunTask(F func, Args&&... args) {
   try {
     co_await func(std::forward<Args>(args)...);
@@ -0,0 +1,337 @@
+#include "coro/util/async_file.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <span>
+#include <utility>
+
+#include "coro/exception.h"
+#include "coro/promise.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/util/raii_utils.h"
+
+#ifdef CORO_HTTP_IO_URING
+#include "coro/util/io_uring.h"
+#endif
+
+namespace coro::util {
+
+namespace {
+
+std::string ErrorMessage(std::string_view what, int error) {
+  return "AsyncFile " + std::string(what) + ": " + strerror(error);
+}
+
+int OpenFile(const std::string& path, AsyncFile::Mode mode) {
+  int flags = 0;
+  switch (mode) {
+    case AsyncFile::Mode::kRead:
+      flags = O_RDONLY;
+      break;
+    case AsyncFile::Mode::kWrite:
+      flags = O_WRONLY | O_CREAT | O_TRUNC;
+      break;
+    case AsyncFile::Mode::kReadWrite:
+      flags = O_RDWR | O_CREAT;
+      break;
+  }
+#ifdef _WIN32
+  return _open(path.c_str(), flags | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+  int fd;
+  do {
+    fd = open(path.c_str(), flags | O_CLOEXEC, 0644);
+  } while (fd == -1 && errno == EINTR);
+  return fd;
+#endif
+}
+
+// Like pread and pwrite, returns -1 and sets errno on failure.
+int64_t PositionalRead(int fd, char* data, size_t size, int64_t offset) {
+#ifdef _WIN32
+  OVERLAPPED overlapped = {};
+  overlapped.Offset = static_cast<DWORD>(offset);
+  overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+  DWORD count = 0;
+  if (!ReadFile(reinterpret_cast<HANDLE>(_get_osfhandle(fd)), data,
+                static_cast<DWORD>(std::min<size_t>(size, MAXDWORD)), &count,
+                &overlapped)) {
+    if (GetLastError() == ERROR_HANDLE_EOF) {
+      return 0;
+    }
+    errno = EIO;
+    return -1;
+  }
+  return count;
+#else
+  ssize_t count;
+  do {
+    count = pread(fd, data, size, offset);
+  } while (count == -1 && errno == EINTR);
+  return count;
+#endif
+}
+
+int64_t PositionalWrite(int fd, const char* data, size_t size,
+                        int64_t offset) {
+#ifdef _WIN32
+  OVERLAPPED overlapped = {};
+  overlapped.Offset = static_cast<DWORD>(offset);
+  overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+  DWORD count = 0;
+  if (!WriteFile(reinterpret_cast<HANDLE>(_get_osfhandle(fd)), data,
+                 static_cast<DWORD>(std::min<size_t>(size, MAXDWORD)), &count,
+                 &overlapped)) {
+    errno = EIO;
+    return -1;
+  }
+  return count;
+#else
+  ssize_t count;
+  do {
+    count = pwrite(fd, data, size, offset);
+  } while (count == -1 && errno == EINTR);
+  return count;
+#endif
+}
+
+template <typename T>
+Task<> Fulfill(Task<T> task, std::shared_ptr<Promise<T>> promise) {
+  try {
+    promise->SetValue(co_await task);
+  } catch (...) {
+    promise->SetException(std::current_exception());
+  }
+}
+
+}  // namespace
+
+struct AsyncFile::Handle {
+  ~Handle() {
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+  }
+
+  ThreadPool* thread_pool;
+  IoUring* io_uring;
+  int fd;
+};
+
+AsyncFile::AsyncFile(std::shared_ptr<Handle> handle)
+    : handle_(std::move(handle)) {}
+
+Task<AsyncFile> AsyncFile::Open(ThreadPool* thread_pool, std::string path,
+                                Mode mode, stdx::stop_token stop_token) {
+  return OpenImpl(thread_pool, /*io_uring=*/nullptr, std::move(path), mode,
+                  std::move(stop_token));
+}
+
+#ifdef CORO_HTTP_IO_URING
+Task<AsyncFile> AsyncFile::Open(ThreadPool* thread_pool, IoUring* io_uring,
+                                std::string path, Mode mode,
+                                stdx::stop_token stop_token) {
+  return OpenImpl(thread_pool, io_uring, std::move(path), mode,
+                  std::move(stop_token));
+}
+#endif
+
+Task<AsyncFile> AsyncFile::OpenImpl(ThreadPool* thread_pool, IoUring* io_uring,
+                                    std::string path, Mode mode,
+                                    stdx::stop_token stop_token) {
+  auto open_file = [path = std::move(path), mode] {
+    int fd = OpenFile(path, mode);
+    if (fd == -1) {
+      throw RuntimeError(ErrorMessage("can't open " + path, errno));
+    }
+    return fd;
+  };
+  int fd =
+      co_await thread_pool->Do(std::move(stop_token), std::move(open_file));
+  co_return AsyncFile(
+      std::shared_ptr<Handle>(new Handle{thread_pool, io_uring, fd}));
+}
+
+Task<std::string> AsyncFile::Read(int64_t offset, size_t size,
+                                  stdx::stop_token stop_token) const {
+  return ReadAt(handle_, offset, size, std::move(stop_token));
+}
+
+Task<std::string> AsyncFile::ReadAt(std::shared_ptr<Handle> handle,
+                                    int64_t offset, size_t size,
+                                    stdx::stop_token stop_token) {
+#ifdef CORO_HTTP_IO_URING
+  if (handle->io_uring) {
+    std::string data(size, 0);
+    size_t read = 0;
+    while (read < size) {
+      size_t count = co_await handle->io_uring->Read(
+          handle->fd,
+          std::span<uint8_t>(reinterpret_cast<uint8_t*>(data.data()) + read,
+                             size - read),
+          offset + read, stop_token);
+      if (count == 0) {
+        break;
+      }
+      read += count;
+    }
+    data.resize(read);
+    co_return data;
+  }
+#endif
+  co_return co_await handle->thread_pool->Do(
+      std::move(stop_token), [fd = handle->fd, offset, size] {
+        std::string data(size, 0);
+        size_t read = 0;
+        while (read < size) {
+          int64_t count =
+              PositionalRead(fd, data.data() + read, size - read,
+                             offset + static_cast<int64_t>(read));
+          if (count == -1) {
+            throw RuntimeError(ErrorMessage("read", errno));
+          }
+          if (count == 0) {
+            break;
+          }
+          read += static_cast<size_t>(count);
+        }
+        data.resize(read);
+        return data;
+      });
+}
+
+Task<> AsyncFile::Write(int64_t offset, std::string_view data,
+                        stdx::stop_token stop_token) const {
+  std::shared_ptr<Handle> handle = handle_;
+#ifdef CORO_HTTP_IO_URING
+  if (handle->io_uring) {
+    size_t written = 0;
+    while (written < data.size()) {
+      written += co_await handle->io_uring->Write(
+          handle->fd,
+          std::span<const uint8_t>(
+              reinterpret_cast<const uint8_t*>(data.data()) + written,
+              data.size() - written),
+          offset + written, stop_token);
+    }
+    co_return;
+  }
+#endif
+  co_await handle->thread_pool->Do(
+      std::move(stop_token), [fd = handle->fd, offset, data] {
+        size_t written = 0;
+        while (written < data.size()) {
+          int64_t count = PositionalWrite(
+              fd, data.data() + written, data.size() - written,
+              offset + static_cast<int64_t>(written));
+          if (count == -1) {
+            throw RuntimeError(ErrorMessage("write", errno));
+          }
+          written += static_cast<size_t>(count);
+        }
+      });
+}
+
+Task<> AsyncFile::Fsync(stdx::stop_token stop_token) const {
+  std::shared_ptr<Handle> handle = handle_;
+  co_await handle->thread_pool->Do(
+      ThreadPool::Priority::kBulk, std::move(stop_token), [fd = handle->fd] {
+#ifdef _WIN32
+        if (_commit(fd) != 0) {
+#else
+        if (fsync(fd) != 0) {
+#endif
+          throw RuntimeError(ErrorMessage("fsync", errno));
+        }
+      });
+}
+
+Task<int64_t> AsyncFile::GetSize(stdx::stop_token stop_token) const {
+  std::shared_ptr<Handle> handle = handle_;
+  co_return co_await handle->thread_pool->Do(
+      std::move(stop_token), [fd = handle->fd] {
+#ifdef _WIN32
+        struct _stat64 st;
+        if (_fstat64(fd, &st) != 0) {
+#else
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+#endif
+          throw RuntimeError(ErrorMessage("stat", errno));
+        }
+        return static_cast<int64_t>(st.st_size);
+      });
+}
+
+Generator<std::string> AsyncFile::ReadStream() const {
+  return Stream(handle_, Range(), StreamConfig());
+}
+
+Generator<std::string> AsyncFile::ReadStream(Range range) const {
+  return Stream(handle_, range, StreamConfig());
+}
+
+Generator<std::string> AsyncFile::ReadStream(Range range,
+                                             StreamConfig config) const {
+  return Stream(handle_, range, config);
+}
+
+Generator<std::string> AsyncFile::Stream(std::shared_ptr<Handle> handle,
+                                         Range range, StreamConfig config) {
+  config.chunk_size = std::max<size_t>(config.chunk_size, 1);
+  stdx::stop_source stop_source;
+  auto cancel = AtScopeExit([&] { stop_source.request_stop(); });
+  // Reads in flight, along with the number of bytes each one asked for.
+  std::deque<std::pair<std::shared_ptr<Promise<std::string>>, size_t>> reads;
+  int64_t offset = range.start;
+  auto read_ahead = [&] {
+    while (reads.size() <= config.readahead &&
+           (!range.end || offset <= *range.end)) {
+      size_t size = config.chunk_size;
+      if (range.end) {
+        size = static_cast<size_t>(
+            std::min<int64_t>(static_cast<int64_t>(size),
+                              *range.end - offset + 1));
+      }
+      auto promise = std::make_shared<Promise<std::string>>();
+      RunTask(Fulfill(ReadAt(handle, offset, size, stop_source.get_token()),
+                      promise));
+      reads.emplace_back(std::move(promise), size);
+      offset += static_cast<int64_t>(size);
+    }
+  };
+  read_ahead();
+  while (!reads.empty()) {
+    std::shared_ptr<Promise<std::string>> read = std::move(reads.front().first);
+    size_t size = reads.front().second;
+    reads.pop_front();
+    Promise<std::string>& promise = *read;
+    std::string chunk = co_await promise;
+    if (chunk.size() < size) {
+      // End of file, the reads past it get cancelled.
+      if (!chunk.empty()) {
+        co_yield std::move(chunk);
+      }
+      co_return;
+    }
+    read_ahead();
+    co_yield std::move(chunk);
+  }
+}
+
+}  // namespace coro::util
@@ -0,0 +1,100 @@
+#ifndef CORO_UTIL_ASYNC_FILE_H
+#define CORO_UTIL_ASYNC_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "coro/generator.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+#include "coro/util/thread_pool.h"
+
+namespace coro::util {
+
+class IoUring;
+
+// File accessed without blocking the event loop. Reads and writes are
+// positional pread/pwrite calls run on `thread_pool`, or operations of
+// `io_uring` when the file was opened with one. Everything else, opening
+// included, runs on `thread_pool`.
+//
+// Has to be used on the event loop's thread of `thread_pool`, which just like
+// `io_uring` has to outlive the file and the streams read from it.
+class AsyncFile {
+ public:
+  enum class Mode {
+    kRead,
+    // Creates the file if needed and truncates it.
+    kWrite,
+    // Creates the file if needed.
+    kReadWrite,
+  };
+
+  // Bytes [start, end], like the HTTP Range header. Without `end`, up to the
+  // end of file.
+  struct Range {
+    int64_t start = 0;
+    std::optional<int64_t> end;
+  };
+
+  struct StreamConfig {
+    size_t chunk_size = 64 * 1024;
+    // Chunks read in advance of the one being consumed.
+    size_t readahead = 4;
+  };
+
+  static Task<AsyncFile> Open(ThreadPool* thread_pool, std::string path,
+                              Mode mode,
+                              stdx::stop_token = stdx::stop_token());
+#ifdef CORO_HTTP_IO_URING
+  static Task<AsyncFile> Open(ThreadPool* thread_pool, IoUring* io_uring,
+                              std::string path, Mode mode,
+                              stdx::stop_token = stdx::stop_token());
+#endif
+
+  AsyncFile(const AsyncFile&) = delete;
+  AsyncFile(AsyncFile&&) noexcept = default;
+  AsyncFile& operator=(const AsyncFile&) = delete;
+  AsyncFile& operator=(AsyncFile&&) noexcept = default;
+
+  // Returns fewer than `size` bytes only at the end of file.
+  Task<std::string> Read(int64_t offset, size_t size,
+                         stdx::stop_token = stdx::stop_token()) const;
+  Task<> Write(int64_t offset, std::string_view data,
+               stdx::stop_token = stdx::stop_token()) const;
+  // Runs as a ThreadPool::Priority::kBulk job, flushing may take long.
+  Task<> Fsync(stdx::stop_token = stdx::stop_token()) const;
+  Task<int64_t> GetSize(stdx::stop_token = stdx::stop_token()) const;
+
+  // Yields `range` in chunks, keeping up to `config.readahead` reads in
+  // flight. The stream shares ownership of the file and may outlive it, so
+  // it can be used as the body of an http::Response directly. Destroying the
+  // stream cancels the reads still in flight.
+  Generator<std::string> ReadStream() const;
+  Generator<std::string> ReadStream(Range range) const;
+  Generator<std::string> ReadStream(Range range, StreamConfig config) const;
+
+ private:
+  struct Handle;
+
+  explicit AsyncFile(std::shared_ptr<Handle> handle);
+
+  static Task<AsyncFile> OpenImpl(ThreadPool* thread_pool, IoUring* io_uring,
+                                  std::string path, Mode mode,
+                                  stdx::stop_token);
+  static Task<std::string> ReadAt(std::shared_ptr<Handle> handle,
+                                  int64_t offset, size_t size,
+                                  stdx::stop_token);
+  static Generator<std::string> Stream(std::shared_ptr<Handle> handle,
+                                       Range range, StreamConfig config);
+
+  std::shared_ptr<Handle> handle_;
+};
+
+}  // namespace coro::util
+
+#endif  // CORO_UTIL_ASYNC_FILE_H
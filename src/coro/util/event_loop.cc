@@ -5,6 +5,8 @@
 
 #include <utility>
 
+#include "coro/util/raii_utils.h"
+
 namespace coro::util {
 
 namespace {
@@ -33,10 +35,7 @@ void EventLoop::EventDeleter::operator()(Event *e) const {
   event_free(reinterpret_cast<struct event *>(e));
 }
 
-bool EventLoop::WaitTask::await_ready() {
-  return interrupted_ ||
-         !event_pending(ToEvent(event_.get()), EV_TIMEOUT, nullptr);
-}
+bool EventLoop::WaitTask::await_ready() { return interrupted_ || !linked(); }
 
 void EventLoop::WaitTask::await_suspend(stdx::coroutine_handle<void> handle) {
   handle_ = handle;
@@ -48,53 +47,217 @@ void EventLoop::WaitTask::await_resume() {
   }
 }
 
-EventLoop::WaitTask::WaitTask(EventBase *event_loop, int msec,
+Expected<void> EventLoop::WaitTask::await_resume_expected() {
+  if (interrupted_) {
+    return Unexpected::Interrupted();
+  }
+  return {};
+}
+
+EventLoop::WaitTask::WaitTask(const EventLoop *event_loop, int msec,
                               stdx::stop_token stop_token)
-    : stop_token_(std::move(stop_token)),
-      stop_callback_(stop_token_, OnCancel{this}) {
+    : event_loop_(event_loop),
+      thread_id_(std::this_thread::get_id()),
+      stop_token_(std::move(stop_token)) {
+  stop_callback_.emplace(stop_token_, OnCancel{this});
   if (!interrupted_) {
-    timeval tv = {.tv_sec = msec / 1000, .tv_usec = msec % 1000 * 1000};
-    event_.reset(reinterpret_cast<Event *>(event_new(
-        ToEventBase(event_loop), -1, EV_TIMEOUT,
-        [](evutil_socket_t, short, void *data) {
-          auto *task = reinterpret_cast<WaitTask *>(data);
-          if (task->handle_) {
-            std::exchange(task->handle_, nullptr).resume();
-          }
-        },
-        this)));
-    event_add(ToEvent(event_.get()), &tv);
+    event_loop_->AddTimer(this, msec);
+  }
+}
+
+EventLoop::WaitTask::~WaitTask() {
+  // Waits for the stop callback in case it runs on another thread right now.
+  stop_callback_.reset();
+  if (remote_cancel_) {
+    *remote_cancel_ = nullptr;
+  }
+  if (linked()) {
+    event_loop_->RemoveTimer(this);
   }
 }
 
 EventLoop::WaitTask EventLoop::Wait(int msec,
                                     stdx::stop_token stop_token) const {
-  return WaitTask(event_loop_.get(), msec, std::move(stop_token));
+  return WaitTask(this, msec, std::move(stop_token));
+}
+
+void EventLoop::WaitTask::OnExpired() {
+  if (handle_) {
+    std::exchange(handle_, nullptr).resume();
+  }
 }
 
 void EventLoop::WaitTask::OnCancel::operator()() const {
-  task->interrupted_ = true;
-  if (task->event_) {
-    event_del(ToEvent(task->event_.get()));
+  if (std::this_thread::get_id() == task->thread_id_) {
+    task->Cancel();
+    return;
   }
-  if (task->handle_) {
-    std::exchange(task->handle_, nullptr).resume();
+  auto remote_cancel = std::make_shared<WaitTask *>(task);
+  task->remote_cancel_ = remote_cancel;
+  task->event_loop_->RunOnce([remote_cancel = std::move(remote_cancel)] {
+    if (WaitTask *task = *remote_cancel) {
+      task->Cancel();
+    }
+  });
+}
+
+void EventLoop::WaitTask::Cancel() {
+  interrupted_ = true;
+  if (linked()) {
+    event_loop_->RemoveTimer(this);
+  }
+  if (handle_) {
+    std::exchange(handle_, nullptr).resume();
   }
 }
 
-void EventLoop::RunOnce(stdx::any_invocable<void() &&> f) const {
-  using F = stdx::any_invocable<void() &&>;
+uint64_t EventLoop::CurrentTick() const {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - start_time_)
+      .count();
+}
 
-  auto *data = new F(std::move(f));
-  if (event_base_once(
-          ToEventBase(event_loop_.get()), -1, EV_TIMEOUT,
-          [](evutil_socket_t, short, void *d) {
-            std::unique_ptr<F> data(static_cast<F *>(d));
-            std::move (*data)();
-          },
-          data, nullptr) != 0) {
-    delete data;
-    throw RuntimeError("can't run on event loop");
+void EventLoop::AddTimer(TimerWheel::Timer *timer, int msec) const {
+  uint64_t now = CurrentTick();
+  // The current tick is already partially over, hence the extra tick.
+  timer_wheel_.Add(timer, msec > 0 ? now + msec + 1 : now);
+  ArmTimer(now);
+}
+
+void EventLoop::RemoveTimer(TimerWheel::Timer *timer) const {
+  timer_wheel_.Remove(timer);
+  if (timer_wheel_.empty() && timer_event_tick_) {
+    // Nothing may keep the event loop alive once all timers are gone.
+    event_del(ToEvent(timer_event_.get()));
+    timer_event_tick_ = std::nullopt;
+  }
+}
+
+void EventLoop::ArmTimer(uint64_t now) const {
+  std::optional<uint64_t> next = timer_wheel_.NextTick();
+  if (!next || (timer_event_tick_ && *timer_event_tick_ <= *next)) {
+    return;
+  }
+  uint64_t delay = *next > now ? *next - now : 0;
+  timeval tv = {};
+  tv.tv_sec = delay / 1000;
+  tv.tv_usec = delay % 1000 * 1000;
+  if (event_add(ToEvent(timer_event_.get()), &tv) != 0) {
+    throw RuntimeError("can't add timer");
+  }
+  timer_event_tick_ = *next;
+}
+
+void EventLoop::OnTimer() {
+  timer_event_tick_ = std::nullopt;
+  timer_wheel_.Advance(CurrentTick());
+  ArmTimer(CurrentTick());
+}
+
+thread_local const EventLoop *EventLoop::current_ = nullptr;
+
+EventLoop::ScheduleTask EventLoop::Schedule() const {
+  return ScheduleTask(this);
+}
+
+EventLoop::ScheduleTask EventLoop::Yield() const { return Schedule(); }
+
+void EventLoop::ScheduleTask::await_suspend(
+    stdx::coroutine_handle<void> handle) {
+  handle_ = handle;
+  if (current_ == event_loop_) {
+    event_loop_->Enqueue(this);
+  } else {
+    event_loop_->EnqueueRemote(this);
+  }
+}
+
+void EventLoop::Enqueue(ScheduleTask *task) const {
+  if (ready_tail_) {
+    ready_tail_->next_ = task;
+    ready_tail_ = task;
+    return;
+  }
+  timeval tv = {};
+  if (event_add(ToEvent(ready_event_.get()), &tv) != 0) {
+    throw RuntimeError("can't schedule on event loop");
+  }
+  ready_head_ = ready_tail_ = task;
+}
+
+void EventLoop::DrainReadyQueue() {
+  ScheduleTask *task = std::exchange(ready_head_, nullptr);
+  ready_tail_ = nullptr;
+  while (task) {
+    // Resuming the coroutine destroys the awaiter.
+    ScheduleTask *next = task->next_;
+    task->handle_.resume();
+    task = next;
+  }
+}
+
+void EventLoop::EnqueueRemote(ScheduleTask *task) const {
+  // Once published, `task` may already be resumed and destroyed by the event
+  // loop.
+  ScheduleTask *head = remote_ready_head_.load(std::memory_order_relaxed);
+  do {
+    task->next_ = head;
+  } while (!remote_ready_head_.compare_exchange_weak(
+      head, task, std::memory_order_release, std::memory_order_relaxed));
+  if (head == nullptr) {
+    event_active(ToEvent(remote_event_.get()), EV_READ, 0);
+  }
+}
+
+struct EventLoop::RemoteTask {
+  RunOnceFunction function;
+  RemoteTask *next;
+};
+
+void EventLoop::RunOnce(RunOnceFunction f) const {
+  auto *task = new RemoteTask{std::move(f), nullptr};
+  // Once published, `task` may already be run and freed by the event loop.
+  RemoteTask *head = remote_head_.load(std::memory_order_relaxed);
+  do {
+    task->next = head;
+  } while (!remote_head_.compare_exchange_weak(head, task,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed));
+  if (head == nullptr) {
+    // Goes through libevent's own cross thread notification, which the
+    // already pending activation makes unnecessary for the rest of the batch.
+    event_active(ToEvent(remote_event_.get()), EV_READ, 0);
+  }
+}
+
+void EventLoop::DrainRemoteQueue() {
+  RemoteTask *task = remote_head_.exchange(nullptr, std::memory_order_acquire);
+  RemoteTask *reversed = nullptr;
+  while (task) {
+    RemoteTask *next = task->next;
+    task->next = reversed;
+    reversed = task;
+    task = next;
+  }
+  while (reversed) {
+    std::unique_ptr<RemoteTask> current(reversed);
+    reversed = reversed->next;
+    std::move(current->function)();
+  }
+  ScheduleTask *ready =
+      remote_ready_head_.exchange(nullptr, std::memory_order_acquire);
+  ScheduleTask *reversed_ready = nullptr;
+  while (ready) {
+    ScheduleTask *next = ready->next_;
+    ready->next_ = reversed_ready;
+    reversed_ready = ready;
+    ready = next;
+  }
+  while (reversed_ready) {
+    // Resuming the coroutine destroys the awaiter.
+    ScheduleTask *next = reversed_ready->next_;
+    reversed_ready->handle_.resume();
+    reversed_ready = next;
   }
 }
 
@@ -133,20 +296,46 @@ EventLoop::EventLoop()
           throw RuntimeError("event_base_new error");
         }
         return reinterpret_cast<EventBase *>(event_base);
-      }()) {
+      }()),
+      ready_event_(reinterpret_cast<Event *>(event_new(
+          ToEventBase(event_loop_.get()), -1, 0,
+          [](evutil_socket_t, short, void *d) {
+            static_cast<EventLoop *>(d)->DrainReadyQueue();
+          },
+          this))),
+      timer_event_(reinterpret_cast<Event *>(event_new(
+          ToEventBase(event_loop_.get()), -1, 0,
+          [](evutil_socket_t, short, void *d) {
+            static_cast<EventLoop *>(d)->OnTimer();
+          },
+          this))),
+      remote_event_(reinterpret_cast<Event *>(event_new(
+          ToEventBase(event_loop_.get()), -1, 0,
+          [](evutil_socket_t, short, void *d) {
+            static_cast<EventLoop *>(d)->DrainRemoteQueue();
+          },
+          this))) {
+  if (!ready_event_ || !timer_event_ || !remote_event_) {
+    throw RuntimeError("event_new error");
+  }
 }
 
-#ifdef _WIN32
 EventLoop::~EventLoop() noexcept {
+  // Functions posted to an event loop which isn't running anymore are dropped.
+  RemoteTask *task = remote_head_.exchange(nullptr, std::memory_order_acquire);
+  while (task) {
+    delete std::exchange(task, task->next);
+  }
+#ifdef _WIN32
   if (WSACleanup() != 0) {
     std::terminate();
   }
-}
-#else
-EventLoop::~EventLoop() noexcept = default;
 #endif
+}
 
 void EventLoop::EnterLoop(EventLoopType type) {
+  const EventLoop *previous = std::exchange(current_, this);
+  auto restore = AtScopeExit([&] { current_ = previous; });
   if (event_base_loop(ToEventBase(event_loop_.get()), [&] {
         switch (type) {
           case EventLoopType::NoExitOnEmpty:
@@ -1,15 +1,22 @@
 #ifndef CORO_HTTP_WAIT_TASK_H
 #define CORO_HTTP_WAIT_TASK_H
 
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <future>
+#include <memory>
+#include <optional>
 #include <stdexcept>
+#include <thread>
 
+#include "coro/expected.h"
 #include "coro/interrupted_exception.h"
 #include "coro/stdx/any_invocable.h"
 #include "coro/stdx/stop_callback.h"
 #include "coro/stdx/stop_token.h"
 #include "coro/task.h"
+#include "coro/util/timer_wheel.h"
 
 namespace coro::util {
 
@@ -21,6 +28,7 @@ enum class EventLoopType {
 class EventLoop {
  public:
   class WaitTask;
+  class ScheduleTask;
 
   EventLoop();
   ~EventLoop() noexcept;
@@ -30,8 +38,28 @@ class EventLoop {
   EventLoop& operator=(const EventLoop&) = delete;
   EventLoop& operator=(EventLoop&&) = delete;
 
+  // Timers are kept in a timer wheel with millisecond granularity, driven by
+  // a single libevent timer. The wait lasts at least `msec`, and less than a
+  // millisecond longer than that on an idle event loop.
+  //
+  // Has to be called and awaited on the event loop's thread. The stop token
+  // may be stopped from any thread though; a stop requested on another thread
+  // is handed over to the event loop, which owns the timer wheel.
   WaitTask Wait(int msec, stdx::stop_token = stdx::stop_token()) const;
 
+  // Suspends the awaiting coroutine and appends it to the event loop's ready
+  // queue. The queue is drained once per event loop iteration, so coroutines
+  // scheduled while draining it are resumed only after pending I/O got a turn.
+  //
+  // Awaited on any other thread, e.g. on another event loop or a ThreadPool
+  // worker, it moves the coroutine over to this event loop's thread instead.
+  // The coroutine is handed over through a lock-free list, neither thread
+  // blocks. The event loop has to keep running until it gets resumed.
+  ScheduleTask Schedule() const;
+
+  // Lets other coroutines and I/O callbacks run before continuing.
+  ScheduleTask Yield() const;
+
   template <typename F>
     requires requires(F func) {
       { func() } -> Awaitable<void>;
@@ -96,6 +124,7 @@ class EventLoop {
  private:
   struct EventBase;
   struct Event;
+  struct RemoteTask;
 
   struct EventBaseDeleter {
     void operator()(EventBase* event_base) const;
@@ -109,14 +138,50 @@ class EventLoop {
     return e.event_loop_.get();
   }
 
-  void RunOnce(stdx::any_invocable<void() &&>) const;
+  using RunOnceFunction =
+      stdx::any_invocable<void() &&, stdx::any_invocable_hot_path_buffer_size>;
+
+  // Lock-free, may be called from any thread. Functions are run in the order
+  // they were posted in.
+  void RunOnce(RunOnceFunction) const;
+  void Enqueue(ScheduleTask*) const;
+  // Lock-free, may be called from any thread.
+  void EnqueueRemote(ScheduleTask*) const;
+  void DrainReadyQueue();
+  void DrainRemoteQueue();
+  uint64_t CurrentTick() const;
+  void AddTimer(TimerWheel::Timer*, int msec) const;
+  void RemoveTimer(TimerWheel::Timer*) const;
+  void ArmTimer(uint64_t now) const;
+  void OnTimer();
 
   std::unique_ptr<EventBase, EventBaseDeleter> event_loop_;
+  std::unique_ptr<Event, EventDeleter> ready_event_;
+  mutable ScheduleTask* ready_head_ = nullptr;
+  mutable ScheduleTask* ready_tail_ = nullptr;
+  std::chrono::steady_clock::time_point start_time_ =
+      std::chrono::steady_clock::now();
+  mutable TimerWheel timer_wheel_;
+  std::unique_ptr<Event, EventDeleter> timer_event_;
+  // Tick for which `timer_event_` is scheduled, if it is.
+  mutable std::optional<uint64_t> timer_event_tick_;
+  std::unique_ptr<Event, EventDeleter> remote_event_;
+  // Functions posted with RunOnce, the most recently posted first. Only the
+  // post which finds the stack empty activates `remote_event_`, the whole
+  // stack is then drained at once.
+  mutable std::atomic<RemoteTask*> remote_head_ = nullptr;
+  // Coroutines scheduled from other threads, the most recent one first. Share
+  // `remote_event_` with the functions posted with RunOnce.
+  mutable std::atomic<ScheduleTask*> remote_ready_head_ = nullptr;
+
+  // Event loop running on the current thread, if any.
+  static thread_local const EventLoop* current_;
 };
 
-class EventLoop::WaitTask {
+class EventLoop::WaitTask : private TimerWheel::Timer {
  public:
-  WaitTask(EventBase* event_loop, int msec, stdx::stop_token);
+  WaitTask(const EventLoop* event_loop, int msec, stdx::stop_token);
+  ~WaitTask() override;
 
   WaitTask(const WaitTask&) = delete;
   WaitTask(WaitTask&&) = delete;
@@ -127,6 +192,7 @@ class EventLoop::WaitTask {
   bool await_ready();
   void await_suspend(stdx::coroutine_handle<void> handle);
   void await_resume();
+  Expected<void> await_resume_expected();
 
  private:
   struct OnCancel {
@@ -134,11 +200,43 @@ class EventLoop::WaitTask {
     WaitTask* task;
   };
 
+  void OnExpired() override;
+  void Cancel();
+
+  const EventLoop* event_loop_;
+  // Thread which created the task, the event loop's one.
+  std::thread::id thread_id_;
   stdx::coroutine_handle<void> handle_;
-  std::unique_ptr<Event, EventDeleter> event_;
   stdx::stop_token stop_token_;
   bool interrupted_ = false;
-  stdx::stop_callback<OnCancel> stop_callback_;
+  // Set when the stop was requested on another thread. Points to the task
+  // until it gets destroyed, so that the cancellation posted to the event
+  // loop can tell whether it still has work to do.
+  std::shared_ptr<WaitTask*> remote_cancel_;
+  std::optional<stdx::stop_callback<OnCancel>> stop_callback_;
+};
+
+class EventLoop::ScheduleTask {
+ public:
+  explicit ScheduleTask(const EventLoop* event_loop) noexcept
+      : event_loop_(event_loop) {}
+
+  ScheduleTask(const ScheduleTask&) = delete;
+  ScheduleTask(ScheduleTask&&) = delete;
+
+  ScheduleTask& operator=(const ScheduleTask&) = delete;
+  ScheduleTask& operator=(ScheduleTask&&) = delete;
+
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(stdx::coroutine_handle<void> handle);
+  void await_resume() const noexcept {}
+
+ private:
+  friend class EventLoop;
+
+  const EventLoop* event_loop_;
+  stdx::coroutine_handle<void> handle_;
+  ScheduleTask* next_ = nullptr;
 };
 
 }  // namespace coro::util
@@ -0,0 +1,57 @@
+#include "coro/util/event_loop_group.h"
+
+#include "coro/exception.h"
+#include "coro/util/thread_pool.h"
+
+namespace coro::util {
+
+EventLoopGroup::EventLoopGroup(unsigned int size, std::string name) {
+  if (size == 0) {
+    throw InvalidArgument("EventLoopGroup needs at least one event loop");
+  }
+  for (unsigned int i = 0; i < size; i++) {
+    event_loops_.emplace_back(std::make_unique<EventLoop>());
+  }
+  try {
+    for (unsigned int i = 0; i < size; i++) {
+      threads_.emplace_back(
+          [event_loop = event_loops_[i].get(), name = name + "-" +
+                                                      std::to_string(i)] {
+            SetThreadName(name);
+            event_loop->EnterLoop(EventLoopType::NoExitOnEmpty);
+          });
+    }
+  } catch (...) {
+    // The destructor doesn't run, the threads started so far would outlive
+    // their event loops.
+    Stop();
+    throw;
+  }
+}
+
+EventLoopGroup::~EventLoopGroup() { Stop(); }
+
+void EventLoopGroup::Stop() {
+  for (auto& event_loop : event_loops_) {
+    event_loop->ExitLoop();
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+std::vector<const EventLoop*> EventLoopGroup::event_loops() const {
+  std::vector<const EventLoop*> result;
+  for (const auto& event_loop : event_loops_) {
+    result.push_back(event_loop.get());
+  }
+  return result;
+}
+
+const EventLoop* EventLoopGroup::Next() const {
+  return event_loops_[next_.fetch_add(1, std::memory_order_relaxed) %
+                      event_loops_.size()]
+      .get();
+}
+
+}  // namespace coro::util
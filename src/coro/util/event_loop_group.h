@@ -0,0 +1,49 @@
+#ifndef CORO_UTIL_EVENT_LOOP_GROUP_H
+#define CORO_UTIL_EVENT_LOOP_GROUP_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "coro/util/event_loop.h"
+
+namespace coro::util {
+
+// Runs `size` event loops, each on its own thread, until destroyed. Work is
+// handed to a loop with EventLoop::RunOnEventLoop; everything started there
+// stays on that loop's thread.
+class EventLoopGroup {
+ public:
+  explicit EventLoopGroup(
+      unsigned int size = std::thread::hardware_concurrency(),
+      std::string name = "coro-loop");
+  ~EventLoopGroup();
+
+  EventLoopGroup(const EventLoopGroup&) = delete;
+  EventLoopGroup(EventLoopGroup&&) = delete;
+  EventLoopGroup& operator=(const EventLoopGroup&) = delete;
+  EventLoopGroup& operator=(EventLoopGroup&&) = delete;
+
+  size_t size() const { return event_loops_.size(); }
+  const EventLoop* event_loop(size_t index) const {
+    return event_loops_[index].get();
+  }
+  std::vector<const EventLoop*> event_loops() const;
+
+  // Picks the event loops in round-robin order. May be called from any thread.
+  const EventLoop* Next() const;
+
+ private:
+  // Exits the event loops and joins the threads started so far.
+  void Stop();
+
+  std::vector<std::unique_ptr<EventLoop>> event_loops_;
+  std::vector<std::thread> threads_;
+  mutable std::atomic<size_t> next_ = 0;
+};
+
+}  // namespace coro::util
+
+#endif  // CORO_UTIL_EVENT_LOOP_GROUP_H
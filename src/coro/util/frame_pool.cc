@@ -0,0 +1,95 @@
+#include "coro/util/frame_pool.h"
+
+#include <array>
+#include <new>
+
+namespace coro::util {
+
+namespace {
+
+constexpr size_t kSizeClassCount = kMaxPooledFrameSize / kFrameSizeClassStep;
+constexpr size_t kMaxCachedFramesPerClass = 64;
+
+struct FreeFrame {
+  FreeFrame* next;
+};
+
+// Trivially destructible on purpose: frames may still be released by other
+// thread local destructors after the pool got torn down, in which case they
+// are handed back to operator delete.
+struct FramePool {
+  std::array<FreeFrame*, kSizeClassCount> free_list;
+  std::array<uint32_t, kSizeClassCount> free_count;
+  uint64_t hit_count;
+  uint64_t miss_count;
+  bool torn_down;
+};
+
+thread_local FramePool gFramePool;
+
+struct FramePoolCleanup {
+  ~FramePoolCleanup() {
+    for (size_t i = 0; i < kSizeClassCount; i++) {
+      while (gFramePool.free_list[i]) {
+        FreeFrame* frame = gFramePool.free_list[i];
+        gFramePool.free_list[i] = frame->next;
+        ::operator delete(static_cast<void*>(frame));
+      }
+      gFramePool.free_count[i] = 0;
+    }
+    gFramePool.torn_down = true;
+  }
+};
+
+thread_local FramePoolCleanup gFramePoolCleanup;
+
+size_t GetSizeClass(size_t size) {
+  return (size + kFrameSizeClassStep - 1) / kFrameSizeClassStep - 1;
+}
+
+}  // namespace
+
+FramePoolStats GetFramePoolStats() noexcept {
+  uint64_t cached_count = 0;
+  for (uint32_t count : gFramePool.free_count) {
+    cached_count += count;
+  }
+  return FramePoolStats{.hit_count = gFramePool.hit_count,
+                        .miss_count = gFramePool.miss_count,
+                        .cached_count = cached_count};
+}
+
+void* AllocateFrame(size_t size) {
+  if (size == 0 || size > kMaxPooledFrameSize || gFramePool.torn_down) {
+    gFramePool.miss_count++;
+    return ::operator new(size);
+  }
+  size_t size_class = GetSizeClass(size);
+  if (FreeFrame* frame = gFramePool.free_list[size_class]) {
+    gFramePool.free_list[size_class] = frame->next;
+    gFramePool.free_count[size_class]--;
+    gFramePool.hit_count++;
+    return frame;
+  }
+  gFramePool.miss_count++;
+  return ::operator new((size_class + 1) * kFrameSizeClassStep);
+}
+
+void DeallocateFrame(void* frame, size_t size) noexcept {
+  if (size == 0 || size > kMaxPooledFrameSize || gFramePool.torn_down) {
+    ::operator delete(frame);
+    return;
+  }
+  size_t size_class = GetSizeClass(size);
+  if (gFramePool.free_count[size_class] >= kMaxCachedFramesPerClass) {
+    ::operator delete(frame);
+    return;
+  }
+  // Make sure cached frames get released when this thread exits.
+  (void)&gFramePoolCleanup;
+  auto* free_frame = ::new (frame) FreeFrame{gFramePool.free_list[size_class]};
+  gFramePool.free_list[size_class] = free_frame;
+  gFramePool.free_count[size_class]++;
+}
+
+}  // namespace coro::util
@@ -0,0 +1,44 @@
+#ifndef CORO_UTIL_FRAME_POOL_H
+#define CORO_UTIL_FRAME_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace coro::util {
+
+struct FramePoolStats {
+  // Allocations served from the calling thread's free lists.
+  uint64_t hit_count;
+  // Allocations which had to fall back to the global operator new.
+  uint64_t miss_count;
+  // Frames currently cached by the calling thread.
+  uint64_t cached_count;
+};
+
+// Statistics of the calling thread's coroutine frame pool.
+FramePoolStats GetFramePoolStats() noexcept;
+
+// Coroutine frames are bucketed by size into classes kFrameSizeClassStep bytes
+// apart. Frames bigger than kMaxPooledFrameSize always go to operator new.
+inline constexpr size_t kFrameSizeClassStep = 64;
+inline constexpr size_t kMaxPooledFrameSize = 4096;
+
+void* AllocateFrame(size_t size);
+void DeallocateFrame(void* frame, size_t size) noexcept;
+
+// Base class for coroutine promise types. When built with
+// CORO_HTTP_FRAME_POOL, frames of coroutines with such promises are recycled
+// through a thread local pool instead of going through global operator new.
+class PooledFrame {
+ public:
+#ifdef CORO_HTTP_FRAME_POOL
+  static void* operator new(size_t size) { return AllocateFrame(size); }
+  static void operator delete(void* frame, size_t size) noexcept {
+    DeallocateFrame(frame, size);
+  }
+#endif
+};
+
+}  // namespace coro::util
+
+#endif  // CORO_UTIL_FRAME_POOL_H
@@ -0,0 +1,113 @@
+#ifndef CORO_UTIL_INTRUSIVE_LIST_H
+#define CORO_UTIL_INTRUSIVE_LIST_H
+
+#include <cstddef>
+
+namespace coro::util {
+
+template <typename T>
+class IntrusiveList;
+
+// Base class for objects which can be linked into an IntrusiveList<T>. An
+// object can be linked into at most one list at a time.
+template <typename T>
+class IntrusiveListNode {
+ public:
+  IntrusiveListNode() = default;
+  IntrusiveListNode(const IntrusiveListNode&) = delete;
+  IntrusiveListNode& operator=(const IntrusiveListNode&) = delete;
+
+  bool linked() const { return list_ != nullptr; }
+
+ private:
+  friend class IntrusiveList<T>;
+
+  T* prev_ = nullptr;
+  T* next_ = nullptr;
+  const IntrusiveList<T>* list_ = nullptr;
+};
+
+// Doubly linked FIFO list of objects it doesn't own. All operations are O(1)
+// and never allocate.
+template <typename T>
+class IntrusiveList {
+ public:
+  IntrusiveList() = default;
+  IntrusiveList(const IntrusiveList&) = delete;
+  IntrusiveList& operator=(const IntrusiveList&) = delete;
+
+  bool empty() const { return head_ == nullptr; }
+  size_t size() const { return size_; }
+  T* front() const { return head_; }
+  bool Contains(const T* item) const { return Node(item)->list_ == this; }
+
+  void PushBack(T* item) {
+    Node(item)->prev_ = tail_;
+    Node(item)->next_ = nullptr;
+    Node(item)->list_ = this;
+    if (tail_) {
+      Node(tail_)->next_ = item;
+    } else {
+      head_ = item;
+    }
+    tail_ = item;
+    size_++;
+  }
+
+  T* PopFront() {
+    T* item = head_;
+    if (item) {
+      Remove(item);
+    }
+    return item;
+  }
+
+  void Remove(T* item) {
+    if (Node(item)->prev_) {
+      Node(Node(item)->prev_)->next_ = Node(item)->next_;
+    } else {
+      head_ = Node(item)->next_;
+    }
+    if (Node(item)->next_) {
+      Node(Node(item)->next_)->prev_ = Node(item)->prev_;
+    } else {
+      tail_ = Node(item)->prev_;
+    }
+    Node(item)->prev_ = Node(item)->next_ = nullptr;
+    Node(item)->list_ = nullptr;
+    size_--;
+  }
+
+  // Moves all the items of `other` to the back of this list. Linear in the
+  // size of `other`, as each of the moved items learns its new owner.
+  void Splice(IntrusiveList& other) {
+    if (other.empty()) {
+      return;
+    }
+    for (T* item = other.head_; item; item = Node(item)->next_) {
+      Node(item)->list_ = this;
+    }
+    if (tail_) {
+      Node(tail_)->next_ = other.head_;
+      Node(other.head_)->prev_ = tail_;
+    } else {
+      head_ = other.head_;
+    }
+    tail_ = other.tail_;
+    size_ += other.size_;
+    other.head_ = other.tail_ = nullptr;
+    other.size_ = 0;
+  }
+
+ private:
+  static IntrusiveListNode<T>* Node(T* item) { return item; }
+  static const IntrusiveListNode<T>* Node(const T* item) { return item; }
+
+  T* head_ = nullptr;
+  T* tail_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace coro::util
+
+#endif  // CORO_UTIL_INTRUSIVE_LIST_H
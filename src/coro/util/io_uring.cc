@@ -0,0 +1,565 @@
+#include "coro/util/io_uring.h"
+
+#include <event2/event.h>
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "coro/exception.h"
+#include "coro/interrupted_exception.h"
+#include "coro/promise.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/util/raii_utils.h"
+
+namespace coro::util {
+
+namespace {
+
+constexpr uint16_t kBufferGroup = 0;
+
+std::string ErrorMessage(std::string_view what, int error) {
+  return "io_uring " + std::string(what) + ": " + strerror(error);
+}
+
+int Check(std::string_view what, int result) {
+  if (result < 0) {
+    throw RuntimeError(ErrorMessage(what, -result));
+  }
+  return result;
+}
+
+unsigned LoadAcquire(unsigned* value) {
+  return std::atomic_ref<unsigned>(*value).load(std::memory_order_acquire);
+}
+
+void StoreRelease(unsigned* value, unsigned new_value) {
+  std::atomic_ref<unsigned>(*value).store(new_value, std::memory_order_release);
+}
+
+template <typename T>
+T* At(void* ring, uint32_t offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+uint64_t ToUserData(const void* completion) {
+  return reinterpret_cast<uint64_t>(completion);
+}
+
+}  // namespace
+
+struct IoUring::Completion : IntrusiveListNode<Completion> {
+  // Called for every CQE, the last one doesn't carry IORING_CQE_F_MORE.
+  virtual void OnComplete(int result, uint32_t flags) = 0;
+  // Whether the kernel may still produce CQEs for it.
+  virtual bool pending() const = 0;
+
+ protected:
+  ~Completion() = default;
+};
+
+struct IoUring::Operation final : Completion {
+  void OnComplete(int result, uint32_t flags) override {
+    // Zero copy sends complete twice, the notification only tells that the
+    // buffer isn't referenced anymore.
+    if (!(flags & IORING_CQE_F_NOTIF)) {
+      cqe = {.result = result, .flags = flags};
+    }
+    if (!(flags & IORING_CQE_F_MORE)) {
+      completed = true;
+      done.SetValue();
+    }
+  }
+
+  bool pending() const override { return !completed; }
+
+  Promise<void> done;
+  Cqe cqe = {};
+  bool completed = false;
+};
+
+struct IoUring::AcceptState final : Completion {
+  explicit AcceptState(IoUring* io_uring) : io_uring(io_uring) {}
+
+  void OnComplete(int result, uint32_t flags) override {
+    if (result >= 0) {
+      sockets.push_back(result);
+    } else if (result != -ECANCELED) {
+      error = -result;
+    }
+    if (!(flags & IORING_CQE_F_MORE)) {
+      armed = false;
+      if (orphaned) {
+        io_uring->Unqueue(this);
+        CloseSockets();
+        delete this;
+        return;
+      }
+    }
+    if (waiter) {
+      std::exchange(waiter, nullptr)->SetValue();
+    }
+  }
+
+  bool pending() const override { return armed; }
+
+  void CloseSockets() {
+    for (int fd : sockets) {
+      close(fd);
+    }
+    sockets.clear();
+  }
+
+  IoUring* io_uring;
+  std::deque<int> sockets;
+  int error = 0;
+  bool armed = false;
+  bool orphaned = false;
+  Promise<void>* waiter = nullptr;
+};
+
+void IoUring::EventDeleter::operator()(void* event) const {
+  event_free(static_cast<struct event*>(event));
+}
+
+IoUring::IoUring(const EventLoop* event_loop, Config config)
+    : event_loop_(event_loop), config_(config) {
+  auto fail = [&](std::string_view what, int error) {
+    Close();
+    throw RuntimeError(ErrorMessage(what, error));
+  };
+  io_uring_params params = {};
+  ring_fd_ =
+      static_cast<int>(syscall(__NR_io_uring_setup, config_.entries, &params));
+  if (ring_fd_ < 0) {
+    fail("setup", errno);
+  }
+  if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+    fail("setup", ENOTSUP);
+  }
+  ring_size_ =
+      std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+               params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+  ring_ = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (ring_ == MAP_FAILED) {
+    ring_ = nullptr;
+    fail("mmap", errno);
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    fail("mmap", errno);
+  }
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+  sq_head_ = At<unsigned>(ring_, params.sq_off.head);
+  sq_tail_ = At<unsigned>(ring_, params.sq_off.tail);
+  sq_flags_ = At<unsigned>(ring_, params.sq_off.flags);
+  sq_array_ = At<unsigned>(ring_, params.sq_off.array);
+  sq_mask_ = *At<unsigned>(ring_, params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  cq_head_ = At<unsigned>(ring_, params.cq_off.head);
+  cq_tail_ = At<unsigned>(ring_, params.cq_off.tail);
+  cq_mask_ = *At<unsigned>(ring_, params.cq_off.ring_mask);
+  cqes_ = At<io_uring_cqe>(ring_, params.cq_off.cqes);
+  sqe_tail_ = submitted_tail_ = *sq_tail_;
+
+  event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (event_fd_ < 0) {
+    fail("eventfd", errno);
+  }
+  if (syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_EVENTFD,
+              &event_fd_, 1) != 0) {
+    fail("register eventfd", errno);
+  }
+  auto* event_base = reinterpret_cast<struct event_base*>(
+      GetEventLoop(*event_loop_));
+  submit_event_.reset(event_new(
+      event_base, -1, 0,
+      [](evutil_socket_t, short, void* d) {
+        static_cast<IoUring*>(d)->Flush();
+      },
+      this));
+  completion_event_.reset(event_new(
+      event_base, event_fd_, EV_READ | EV_PERSIST,
+      [](evutil_socket_t fd, short, void* d) {
+        uint64_t count;
+        while (read(fd, &count, sizeof(count)) > 0) {
+        }
+        static_cast<IoUring*>(d)->Reap();
+      },
+      this));
+  if (!submit_event_ || !completion_event_) {
+    fail("event_new", ENOMEM);
+  }
+}
+
+IoUring::~IoUring() { Close(); }
+
+void IoUring::Close() noexcept {
+  submit_event_.reset();
+  completion_event_.reset();
+  if (sqes_) {
+    munmap(sqes_, sqes_size_);
+    sqes_ = nullptr;
+  }
+  if (ring_) {
+    munmap(ring_, ring_size_);
+    ring_ = nullptr;
+  }
+  if (event_fd_ >= 0) {
+    close(event_fd_);
+    event_fd_ = -1;
+  }
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+    ring_fd_ = -1;
+  }
+}
+
+Task<size_t> IoUring::Read(int fd, std::span<uint8_t> buffer, uint64_t offset,
+                           stdx::stop_token stop_token) {
+  Cqe cqe = co_await Submit(std::move(stop_token), [&](io_uring_sqe* sqe) {
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = ToUserData(buffer.data());
+    sqe->len = static_cast<uint32_t>(buffer.size());
+    sqe->off = offset;
+  });
+  co_return Check("read", cqe.result);
+}
+
+Task<size_t> IoUring::Write(int fd, std::span<const uint8_t> buffer,
+                            uint64_t offset, stdx::stop_token stop_token) {
+  Cqe cqe = co_await Submit(std::move(stop_token), [&](io_uring_sqe* sqe) {
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = ToUserData(buffer.data());
+    sqe->len = static_cast<uint32_t>(buffer.size());
+    sqe->off = offset;
+  });
+  co_return Check("write", cqe.result);
+}
+
+Task<size_t> IoUring::Send(int fd, std::span<const uint8_t> buffer,
+                           stdx::stop_token stop_token) {
+  auto prepare = [&](uint8_t opcode) {
+    return [&, opcode](io_uring_sqe* sqe) {
+      sqe->opcode = opcode;
+      sqe->fd = fd;
+      sqe->addr = ToUserData(buffer.data());
+      sqe->len = static_cast<uint32_t>(buffer.size());
+      sqe->msg_flags = MSG_NOSIGNAL;
+    };
+  };
+  bool zero_copy =
+      zero_copy_supported_ && buffer.size() >= config_.zero_copy_threshold;
+  Cqe cqe = co_await Submit(
+      stop_token, prepare(zero_copy ? IORING_OP_SEND_ZC : IORING_OP_SEND));
+  if (zero_copy && (cqe.result == -EINVAL || cqe.result == -EOPNOTSUPP)) {
+    // Kernels older than 6.0 don't know IORING_OP_SEND_ZC at all, others
+    // don't support it for every socket type.
+    if (cqe.result == -EINVAL) {
+      zero_copy_supported_ = false;
+    }
+    cqe = co_await Submit(std::move(stop_token), prepare(IORING_OP_SEND));
+  }
+  co_return Check("send", cqe.result);
+}
+
+Task<std::vector<uint8_t>> IoUring::Recv(int fd, stdx::stop_token stop_token) {
+  if (config_.buffer_count == 0) {
+    co_return co_await RecvWithoutProvidedBuffer(fd, std::move(stop_token));
+  }
+  if (buffers_.empty()) {
+    // Provided lazily, so that the ring may be constructed on any thread.
+    buffers_.resize(size_t(config_.buffer_count) * config_.buffer_size);
+    ProvideBuffers(0, config_.buffer_count);
+  }
+  Cqe cqe = co_await Submit(stop_token, [&](io_uring_sqe* sqe) {
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->len = config_.buffer_size;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = kBufferGroup;
+  });
+  if (cqe.result == -ENOBUFS) {
+    // All the provided buffers are held by other receives.
+    co_return co_await RecvWithoutProvidedBuffer(fd, std::move(stop_token));
+  }
+  Check("recv", cqe.result);
+  if (!(cqe.flags & IORING_CQE_F_BUFFER)) {
+    co_return std::vector<uint8_t>();
+  }
+  unsigned id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+  const uint8_t* data = buffers_.data() + size_t(id) * config_.buffer_size;
+  std::vector<uint8_t> result(data, data + cqe.result);
+  ProvideBuffers(id, 1);
+  co_return result;
+}
+
+Task<std::vector<uint8_t>> IoUring::RecvWithoutProvidedBuffer(
+    int fd, stdx::stop_token stop_token) {
+  std::vector<uint8_t> data(config_.buffer_size);
+  Cqe cqe = co_await Submit(std::move(stop_token), [&](io_uring_sqe* sqe) {
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->addr = ToUserData(data.data());
+    sqe->len = static_cast<uint32_t>(data.size());
+  });
+  data.resize(Check("recv", cqe.result));
+  co_return data;
+}
+
+Task<> IoUring::WaitIdle() const { co_await idle_.Wait(); }
+
+template <typename F>
+Task<IoUring::Cqe> IoUring::Submit(stdx::stop_token stop_token, F prepare) {
+  if (stop_token.stop_requested()) {
+    throw InterruptedException();
+  }
+  Operation operation;
+  io_uring_sqe* sqe = GetSqe();
+  prepare(sqe);
+  sqe->user_data = ToUserData(static_cast<Completion*>(&operation));
+  AddPending();
+  {
+    // The kernel may still write to the buffers until the cancelled operation
+    // completes, so it's awaited in any case.
+    stdx::stop_callback stop_callback(stop_token,
+                                      [&] { QueueCancel(&operation); });
+    co_await operation.done;
+  }
+  if (stop_token.stop_requested()) {
+    Unqueue(&operation);
+  }
+  if (operation.cqe.result == -ECANCELED && stop_token.stop_requested()) {
+    throw InterruptedException();
+  }
+  co_return operation.cqe;
+}
+
+io_uring_sqe* IoUring::GetSqe() {
+  io_uring_sqe* sqe = TryGetSqe();
+  if (!sqe) {
+    Flush();
+    sqe = TryGetSqe();
+    if (!sqe) {
+      throw RuntimeError("io_uring submission queue full");
+    }
+  }
+  return sqe;
+}
+
+io_uring_sqe* IoUring::TryGetSqe() {
+  if (sqe_tail_ - LoadAcquire(sq_head_) == sq_entries_) {
+    return nullptr;
+  }
+  unsigned index = sqe_tail_ & sq_mask_;
+  io_uring_sqe* sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(io_uring_sqe));
+  sq_array_[index] = index;
+  if (sqe_tail_++ == submitted_tail_) {
+    // Everything queued until the event fires goes in with one syscall.
+    event_active(static_cast<struct event*>(submit_event_.get()), 0, 0);
+  }
+  return sqe;
+}
+
+void IoUring::AddPending() {
+  if (pending_count_++ == 0) {
+    idle_.Reset();
+  }
+  if (!completion_event_added_) {
+    if (event_add(static_cast<struct event*>(completion_event_.get()),
+                  nullptr) != 0) {
+      throw RuntimeError("can't watch io_uring completions");
+    }
+    completion_event_added_ = true;
+  }
+}
+
+void IoUring::QueueCancel(Completion* completion) noexcept {
+  {
+    std::lock_guard lock(cancel_mutex_);
+    if (completion->linked()) {
+      return;
+    }
+    cancels_.PushBack(completion);
+  }
+  event_active(static_cast<struct event*>(submit_event_.get()), 0, 0);
+}
+
+void IoUring::Unqueue(Completion* completion) {
+  std::lock_guard lock(cancel_mutex_);
+  if (completion->linked()) {
+    cancels_.Remove(completion);
+  }
+}
+
+bool IoUring::SubmitCancellations() {
+  std::lock_guard lock(cancel_mutex_);
+  while (Completion* completion = cancels_.front()) {
+    if (completion->pending()) {
+      io_uring_sqe* sqe = TryGetSqe();
+      if (!sqe) {
+        return false;
+      }
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->addr = ToUserData(completion);
+      sqe->user_data = 0;
+      AddPending();
+    }
+    cancels_.Remove(completion);
+  }
+  return true;
+}
+
+void IoUring::ProvideBuffers(unsigned first, unsigned count) {
+  io_uring_sqe* sqe = GetSqe();
+  sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+  sqe->fd = static_cast<int>(count);
+  sqe->addr = ToUserData(buffers_.data() + size_t(first) * config_.buffer_size);
+  sqe->len = config_.buffer_size;
+  sqe->off = first;
+  sqe->buf_group = kBufferGroup;
+  sqe->user_data = 0;
+  AddPending();
+}
+
+void IoUring::Flush() {
+  if (!SubmitCancellations()) {
+    // Submits the rest once the kernel consumed some of the queue.
+    event_active(static_cast<struct event*>(submit_event_.get()), 0, 0);
+  }
+  StoreRelease(sq_tail_, sqe_tail_);
+  while (submitted_tail_ != sqe_tail_) {
+    auto count = syscall(__NR_io_uring_enter, ring_fd_,
+                         sqe_tail_ - submitted_tail_, 0, 0, nullptr, 0);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EBUSY) {
+        // The kernel is short on resources, retry on the next iteration.
+        event_active(static_cast<struct event*>(submit_event_.get()), 0, 0);
+        return;
+      }
+      throw RuntimeError(ErrorMessage("enter", errno));
+    }
+    submitted_tail_ += static_cast<unsigned>(count);
+  }
+}
+
+void IoUring::Reap() {
+  auto* cqes = static_cast<io_uring_cqe*>(cqes_);
+  while (true) {
+    unsigned head = *cq_head_;
+    while (head != LoadAcquire(cq_tail_)) {
+      io_uring_cqe cqe = cqes[head & cq_mask_];
+      StoreRelease(cq_head_, ++head);
+      if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        pending_count_--;
+      }
+      if (cqe.user_data != 0) {
+        // May resume coroutines which submit more operations.
+        reinterpret_cast<Completion*>(cqe.user_data)
+            ->OnComplete(cqe.res, cqe.flags);
+      }
+    }
+    // Completions which didn't fit into the full completion queue are held
+    // back by the kernel, without signalling the eventfd, until asked for.
+    if (!(LoadAcquire(sq_flags_) & IORING_SQ_CQ_OVERFLOW) ||
+        (syscall(__NR_io_uring_enter, ring_fd_, 0, 0, IORING_ENTER_GETEVENTS,
+                 nullptr, 0) < 0 &&
+         errno != EINTR)) {
+      break;
+    }
+  }
+  if (pending_count_ == 0) {
+    // Nothing may keep the event loop alive once all operations completed.
+    event_del(static_cast<struct event*>(completion_event_.get()));
+    completion_event_added_ = false;
+    idle_.Set();
+  }
+}
+
+IoUring::Acceptor::Acceptor(IoUring* io_uring, int fd)
+    : io_uring_(io_uring), fd_(fd), state_(new AcceptState(io_uring)) {
+  Arm();
+}
+
+IoUring::Acceptor::~Acceptor() {
+  state_->CloseSockets();
+  if (state_->armed) {
+    state_->orphaned = true;
+    io_uring_->QueueCancel(state_);
+  } else {
+    delete state_;
+  }
+}
+
+void IoUring::Acceptor::Arm() {
+  io_uring_sqe* sqe = io_uring_->GetSqe();
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = fd_;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_CLOEXEC;
+  sqe->user_data = ToUserData(static_cast<Completion*>(state_));
+  io_uring_->AddPending();
+  state_->armed = true;
+}
+
+Task<int> IoUring::Acceptor::Accept(stdx::stop_token stop_token) {
+  while (state_->sockets.empty()) {
+    if (state_->error != 0) {
+      int error = std::exchange(state_->error, 0);
+      throw RuntimeError(ErrorMessage("accept", error));
+    }
+    if (!state_->armed) {
+      Arm();
+    }
+    Promise<void> waiter;
+    state_->waiter = &waiter;
+    // Set by the stop callback, which may run on any thread; the waiter is
+    // only interrupted on the event loop, unless the wait is over by then.
+    std::shared_ptr<Promise<void>*> remote_cancel;
+    auto guard = AtScopeExit([&] {
+      if (remote_cancel) {
+        *remote_cancel = nullptr;
+      }
+      if (state_->waiter == &waiter) {
+        state_->waiter = nullptr;
+      }
+    });
+    stdx::stop_callback stop_callback(stop_token, [&] {
+      remote_cancel = std::make_shared<Promise<void>*>(&waiter);
+      io_uring_->event_loop_->RunOnEventLoop([this, remote_cancel] {
+        Promise<void>* waiter = *remote_cancel;
+        if (waiter && state_->waiter == waiter) {
+          state_->waiter = nullptr;
+          // Resumes the awaiting coroutine inline, which destroys `waiter`.
+          waiter->SetInterrupted();
+        }
+      });
+    });
+    co_await waiter;
+  }
+  int fd = state_->sockets.front();
+  state_->sockets.pop_front();
+  co_return fd;
+}
+
+}  // namespace coro::util
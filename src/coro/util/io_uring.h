@@ -0,0 +1,164 @@
+#ifndef CORO_UTIL_IO_URING_H
+#define CORO_UTIL_IO_URING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include "coro/async_event.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+#include "coro/util/event_loop.h"
+#include "coro/util/intrusive_list.h"
+
+struct io_uring_sqe;
+
+namespace coro::util {
+
+// Linux io_uring instance driven by an EventLoop, available when built with
+// WITH_IO_URING. Submissions made during an event loop iteration are handed
+// to the kernel together with a single io_uring_enter call; completions are
+// signalled through an eventfd watched by the event loop.
+//
+// May be constructed on any thread, but has to be used on the event loop's
+// thread only and must outlive all of its pending operations. Stopping the
+// stop token of an operation, which may happen on any thread, cancels it in
+// the kernel; the operation then throws InterruptedException.
+class IoUring {
+ public:
+  class Acceptor;
+
+  struct Config {
+    unsigned entries = 256;
+    // Receive buffers shared by all pending Recv operations.
+    unsigned buffer_count = 64;
+    unsigned buffer_size = 16 * 1024;
+    // Sends at least this big use IORING_OP_SEND_ZC where available.
+    size_t zero_copy_threshold = 16 * 1024;
+  };
+
+  explicit IoUring(const EventLoop* event_loop) : IoUring(event_loop, {}) {}
+  IoUring(const EventLoop* event_loop, Config config);
+  ~IoUring();
+
+  IoUring(const IoUring&) = delete;
+  IoUring(IoUring&&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+  IoUring& operator=(IoUring&&) = delete;
+
+  // Return the number of bytes transferred.
+  Task<size_t> Read(int fd, std::span<uint8_t> buffer, uint64_t offset,
+                    stdx::stop_token = stdx::stop_token());
+  Task<size_t> Write(int fd, std::span<const uint8_t> buffer, uint64_t offset,
+                     stdx::stop_token = stdx::stop_token());
+  Task<size_t> Send(int fd, std::span<const uint8_t> buffer,
+                    stdx::stop_token = stdx::stop_token());
+
+  // Receives into one of the ring's provided buffers and returns a copy of
+  // the data, empty once the peer closed the connection.
+  Task<std::vector<uint8_t>> Recv(int fd,
+                                  stdx::stop_token = stdx::stop_token());
+
+  // Resumes once the kernel is done with all operations, including the ones
+  // abandoned by a destroyed Acceptor. Has to be awaited before destroying the
+  // ring.
+  Task<> WaitIdle() const;
+
+  size_t pending_count() const { return pending_count_; }
+
+ private:
+  struct Completion;
+  struct Operation;
+  struct AcceptState;
+  struct Cqe {
+    int result;
+    uint32_t flags;
+  };
+
+  template <typename F>
+  Task<Cqe> Submit(stdx::stop_token, F prepare);
+  Task<std::vector<uint8_t>> RecvWithoutProvidedBuffer(int fd,
+                                                       stdx::stop_token);
+  // Returns nullptr if the submission queue is full.
+  io_uring_sqe* TryGetSqe();
+  io_uring_sqe* GetSqe();
+  void AddPending();
+  // May be called on any thread. The cancellation gets submitted on the next
+  // Flush, unless the operation completes before.
+  void QueueCancel(Completion*) noexcept;
+  void Unqueue(Completion*);
+  // Returns false if the submission queue got full before all the queued
+  // cancellations were submitted.
+  bool SubmitCancellations();
+  void ProvideBuffers(unsigned first, unsigned count);
+  void Flush();
+  void Reap();
+  void Close() noexcept;
+
+  struct EventDeleter {
+    void operator()(void* event) const;
+  };
+
+  const EventLoop* event_loop_;
+  Config config_;
+  int ring_fd_ = -1;
+  int event_fd_ = -1;
+  void* ring_ = nullptr;
+  size_t ring_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  unsigned* sq_head_;
+  unsigned* sq_tail_;
+  unsigned* sq_flags_;
+  unsigned* sq_array_;
+  unsigned sq_mask_;
+  unsigned sq_entries_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned cq_mask_;
+  void* cqes_;
+  // SQEs filled in so far, and handed to the kernel so far.
+  unsigned sqe_tail_ = 0;
+  unsigned submitted_tail_ = 0;
+  // Operations whose last completion didn't arrive yet.
+  size_t pending_count_ = 0;
+  bool zero_copy_supported_ = true;
+  std::vector<uint8_t> buffers_;
+  std::unique_ptr<void, EventDeleter> submit_event_;
+  std::unique_ptr<void, EventDeleter> completion_event_;
+  bool completion_event_added_ = false;
+  std::mutex cancel_mutex_;
+  IntrusiveList<Completion> cancels_;
+  mutable AsyncEvent idle_{AsyncEventMode::kManualReset, /*set=*/true};
+};
+
+// Keeps a multishot accept armed on a listening socket. Accepted sockets are
+// queued until Accept picks them up.
+class IoUring::Acceptor {
+ public:
+  Acceptor(IoUring* io_uring, int fd);
+  ~Acceptor();
+
+  Acceptor(const Acceptor&) = delete;
+  Acceptor(Acceptor&&) = delete;
+  Acceptor& operator=(const Acceptor&) = delete;
+  Acceptor& operator=(Acceptor&&) = delete;
+
+  // Returns the next accepted socket, which the caller owns.
+  Task<int> Accept(stdx::stop_token = stdx::stop_token());
+
+ private:
+  void Arm();
+
+  IoUring* io_uring_;
+  int fd_;
+  // Freed with the last completion of the multishot accept.
+  AcceptState* state_;
+};
+
+}  // namespace coro::util
+
+#endif  // CORO_UTIL_IO_URING_H
@@ -10,18 +10,29 @@
 
 #include <cstring>
 #include <iostream>
+#include <limits>
 #include <span>
 
+#include "coro/async_event.h"
 #include "coro/exception.h"
+#include "coro/expected.h"
 #include "coro/util/raii_utils.h"
 
+#ifdef CORO_HTTP_IO_URING
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "coro/util/io_uring.h"
+#endif
+
 namespace coro::util {
 
 namespace {
 
 struct RequestContext {
-  Promise<void> read_semaphore;
-  Promise<void> write_semaphore;
+  AsyncEvent read_event{AsyncEventMode::kAutoReset};
+  AsyncEvent write_event{AsyncEventMode::kAutoReset};
   stdx::stop_source stop_source;
   std::vector<uint8_t> request;
 };
@@ -40,25 +51,19 @@ void Check(int code) {
   }
 }
 
-Task<> WaitRead(RequestContext* context) {
-  if (context->stop_source.get_token().stop_requested()) {
-    throw InterruptedException();
-  } else {
-    co_await context->read_semaphore;
-    context->read_semaphore = Promise<void>();
-  }
+Task<Expected<void>> WaitRead(RequestContext* context) {
+  co_return co_await AsExpected(
+      context->read_event.Wait(context->stop_source.get_token()));
 }
 
-Task<> WaitWrite(RequestContext* context) {
-  if (context->stop_source.get_token().stop_requested()) {
-    throw InterruptedException();
-  } else {
-    co_await context->write_semaphore;
-    context->write_semaphore = Promise<void>();
-  }
+Task<Expected<void>> WaitWrite(RequestContext* context) {
+  co_return co_await AsExpected(
+      context->write_event.Wait(context->stop_source.get_token()));
 }
 
-Task<> Write(RequestContext* context, bufferevent* bev, TcpResponseChunk data) {
+// Fails without throwing once the connection got closed.
+Task<Expected<void>> Write(RequestContext* context, bufferevent* bev,
+                           TcpResponseChunk data) {
   std::unique_ptr<evbuffer, EvBufferDeleter> buffer{evbuffer_new()};
   if (!buffer) {
     throw RuntimeError("evbuffer_new error");
@@ -74,17 +79,17 @@ Task<> Write(RequestContext* context, bufferevent* bev, TcpResponseChunk data) {
       },
       /*cleanupfnarg=*/chunk.release()));
   Check(bufferevent_write_buffer(bev, buffer.get()));
-  co_await WaitWrite(context);
+  co_return co_await WaitWrite(context);
 }
 
 void ReadCallback(struct bufferevent*, void* user_data) {
   auto* context = reinterpret_cast<RequestContext*>(user_data);
-  context->read_semaphore.SetValue();
+  context->read_event.Set();
 }
 
 void WriteCallback(struct bufferevent*, void* user_data) {
   auto* context = reinterpret_cast<RequestContext*>(user_data);
-  context->write_semaphore.SetValue();
+  context->write_event.Set();
 }
 
 void EventCallback(struct bufferevent*, short events, void* user_data) {
@@ -109,6 +114,28 @@ std::unique_ptr<bufferevent, BufferEventDeleter> CreateBufferEvent(
   return bev;
 }
 
+evconnlistener* CreateListener(event_base* event_loop,
+                               const TcpServer::Config& config,
+                               unsigned flags, evconnlistener_cb callback,
+                               void* data) {
+  union {
+    struct sockaddr_in sin;
+    struct sockaddr sockaddr;
+  } d;
+  memset(&d.sin, 0, sizeof(sockaddr_in));
+  inet_pton(AF_INET, config.address.c_str(), &d.sin.sin_addr);
+  d.sin.sin_family = AF_INET;
+  d.sin.sin_port = htons(config.port);
+  auto* listener = evconnlistener_new_bind(
+      event_loop, callback, data,
+      LEV_OPT_REUSEABLE | LEV_OPT_CLOSE_ON_FREE | LEV_OPT_THREADSAFE | flags,
+      /*backlog=*/-1, &d.sockaddr, sizeof(sockaddr_in));
+  if (listener == nullptr) {
+    throw RuntimeError("evconnlistener_new_bind error");
+  }
+  return listener;
+}
+
 TcpRequestDataProvider GetRequestContent(struct bufferevent* bev,
                                          RequestContext* context) {
   return [bev, context](uint32_t byte_cnt) -> Task<std::vector<uint8_t>> {
@@ -121,7 +148,7 @@ TcpRequestDataProvider GetRequestContent(struct bufferevent* bev,
     struct evbuffer* input = bufferevent_get_input(bev);
     size_t size = evbuffer_get_length(input);
     if (size == 0) {
-      co_await WaitRead(context);
+      (co_await WaitRead(context)).value();
       size = evbuffer_get_length(input);
     }
     if (byte_cnt == UINT32_MAX) {
@@ -132,7 +159,7 @@ TcpRequestDataProvider GetRequestContent(struct bufferevent* bev,
       co_return data;
     }
     while (size < byte_cnt) {
-      co_await WaitRead(context);
+      (co_await WaitRead(context)).value();
       size = evbuffer_get_length(input);
     }
     std::vector<uint8_t> data(byte_cnt, 0);
@@ -144,6 +171,106 @@ TcpRequestDataProvider GetRequestContent(struct bufferevent* bev,
   };
 }
 
+// Keeps `event_loop` from exiting on empty until `stop_token` gets stopped.
+Task<> KeepAlive(const EventLoop* event_loop, stdx::stop_token stop_token) {
+  co_await event_loop->Wait(std::numeric_limits<int>::max(),
+                            std::move(stop_token));
+}
+
+#ifdef CORO_HTTP_IO_URING
+
+struct IoUringContext {
+  IoUring* io_uring;
+  int fd;
+  stdx::stop_source stop_source;
+  // Received bytes the request handler didn't ask for yet.
+  std::vector<uint8_t> pending;
+};
+
+int CreateSocket(const TcpServer::Config& config, bool reuse_port) {
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    throw RuntimeError("socket error");
+  }
+  auto guard = AtScopeExit([&] {
+    if (fd >= 0) {
+      close(fd);
+    }
+  });
+  int one = 1;
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+      (reuse_port &&
+       setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0)) {
+    throw RuntimeError("setsockopt error");
+  }
+  sockaddr_in addr = {};
+  inet_pton(AF_INET, config.address.c_str(), &addr.sin_addr);
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(config.port);
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      listen(fd, SOMAXCONN) != 0) {
+    throw RuntimeError("can't listen on " + config.address + ":" +
+                       std::to_string(config.port));
+  }
+  return std::exchange(fd, -1);
+}
+
+// Throws InterruptedException once the peer closed the connection.
+Task<> Receive(IoUringContext* context) {
+  std::vector<uint8_t> data = co_await context->io_uring->Recv(
+      context->fd, context->stop_source.get_token());
+  if (data.empty()) {
+    context->stop_source.request_stop();
+    throw InterruptedException();
+  }
+  if (context->pending.empty()) {
+    context->pending = std::move(data);
+  } else {
+    context->pending.insert(context->pending.end(), data.begin(), data.end());
+  }
+}
+
+// Fails without throwing once the connection got closed.
+Task<Expected<void>> Send(IoUringContext* context, TcpResponseChunk data) {
+  std::span<const uint8_t> chunk = data.chunk();
+  while (!chunk.empty()) {
+    auto sent = co_await AsExpected(context->io_uring->Send(
+        context->fd, chunk, context->stop_source.get_token()));
+    if (!sent) {
+      co_return sent.error();
+    }
+    chunk = chunk.subspan(*sent);
+  }
+  co_return Expected<void>();
+}
+
+TcpRequestDataProvider GetRequestContent(IoUringContext* context) {
+  return [context](uint32_t byte_cnt) -> Task<std::vector<uint8_t>> {
+    if (byte_cnt != UINT32_MAX && byte_cnt > kMaxBufferSize) {
+      throw InvalidArgument("requested too big request chunk");
+    }
+    if (byte_cnt == 0) {
+      co_return std::vector<uint8_t>();
+    }
+    if (context->pending.empty()) {
+      co_await Receive(context);
+    }
+    if (byte_cnt == UINT32_MAX) {
+      co_return std::exchange(context->pending, {});
+    }
+    while (context->pending.size() < byte_cnt) {
+      co_await Receive(context);
+    }
+    std::vector<uint8_t> data(context->pending.begin(),
+                              context->pending.begin() + byte_cnt);
+    context->pending.erase(context->pending.begin(),
+                           context->pending.begin() + byte_cnt);
+    co_return data;
+  };
+}
+
+#endif  // CORO_HTTP_IO_URING
+
 }  // namespace
 
 Task<> DrainTcpDataProvider(TcpRequestDataProvider data_provider) {
@@ -165,101 +292,261 @@ void TcpServer::EvconnListenerDeleter::operator()(
   evconnlistener_free(reinterpret_cast<evconnlistener*>(listener));
 }
 
+void TcpServer::IoUringDeleter::operator()(IoUring* io_uring) const noexcept {
+#ifdef CORO_HTTP_IO_URING
+  delete io_uring;
+#endif
+}
+
 TcpServer::TcpServer(TcpRequestHandler request_handler,
                      const EventLoop* event_loop, const Config& config)
-    : request_handler_(std::move(request_handler)),
-      event_loop_(event_loop),
-      listener_(CreateListener(config)) {}
+    : request_handler_(std::move(request_handler)), event_loop_(event_loop) {
+  shards_.emplace_back(std::make_unique<Shard>(this, event_loop));
+  Listen(config, /*reuse_port=*/false);
+}
 
-void TcpServer::OnQuit() {
-  event_loop_->RunOnEventLoop([this] {
-    listener_.reset();
-    quit_semaphore_.SetValue();
-  });
+TcpServer::TcpServer(TcpRequestHandler request_handler,
+                     const EventLoop* event_loop, const EventLoopGroup* group,
+                     const Config& config)
+    : request_handler_(std::move(request_handler)), event_loop_(event_loop) {
+  for (const EventLoop* shard_event_loop : group->event_loops()) {
+    shards_.emplace_back(std::make_unique<Shard>(this, shard_event_loop));
+  }
+  if (config.distribution == Distribution::kRoundRobin) {
+    acceptor_ = std::make_unique<Shard>(this, event_loop);
+  }
+  Listen(config, /*reuse_port=*/true);
 }
 
 Task<> TcpServer::Quit() {
   if (quitting_) {
     co_return;
   }
-  stop_source_.request_stop();
   quitting_ = true;
-  if (current_connections_ == 0) {
-    OnQuit();
+  // Sockets already handed to a shard are queued on its event loop ahead of
+  // QuitShard, so none of them arrives at a stopped shard.
+  if (acceptor_) {
+    co_await StopShard(acceptor_.get());
+  }
+  // The shards report back through RunOnEventLoop, which doesn't prevent an
+  // otherwise idle event loop from exiting before all of them are done.
+  stdx::stop_source keep_alive;
+  RunTask(KeepAlive(event_loop_, keep_alive.get_token()));
+  running_shard_count_ = shards_.size();
+  for (auto& shard : shards_) {
+    shard->event_loop->RunOnEventLoop(
+        [this, shard = shard.get()] { return QuitShard(shard); });
   }
   co_await quit_semaphore_;
+  keep_alive.request_stop();
+}
+
+Task<> TcpServer::StopShard(Shard* shard) {
+  shard->listener.reset();
+  shard->connections.RequestStop();
+  co_await shard->connections.Join();
+#ifdef CORO_HTTP_IO_URING
+  if (shard->io_uring) {
+    co_await shard->io_uring->WaitIdle();
+  }
+#endif
+}
+
+Task<> TcpServer::QuitShard(Shard* shard) {
+  co_await StopShard(shard);
+  event_loop_->RunOnEventLoop([this] {
+    if (--running_shard_count_ == 0) {
+      quit_semaphore_.SetValue();
+    }
+  });
 }
 
 uint16_t TcpServer::GetPort() const {
+  const Shard* shard = acceptor_ ? acceptor_.get() : shards_[0].get();
+  socket_t fd = shard->listener
+                    ? evconnlistener_get_fd(reinterpret_cast<evconnlistener*>(
+                          shard->listener.get()))
+                    : shard->listen_fd;
   sockaddr_in addr;
   socklen_t length = sizeof(addr);
-  Check(getsockname(
-      evconnlistener_get_fd(reinterpret_cast<evconnlistener*>(listener_.get())),
-      reinterpret_cast<sockaddr*>(&addr), &length));
+  Check(getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &length));
   return ntohs(addr.sin_port);
 }
 
-auto TcpServer::CreateListener(const Config& config)
-    -> std::unique_ptr<EvconnListener, EvconnListenerDeleter> {
-  union {
-    struct sockaddr_in sin;
-    struct sockaddr sockaddr;
-  } d;
-  memset(&d.sin, 0, sizeof(sockaddr_in));
-  inet_pton(AF_INET, config.address.c_str(), &d.sin.sin_addr);
-  d.sin.sin_family = AF_INET;
-  d.sin.sin_port = htons(config.port);
-  auto* listener = evconnlistener_new_bind(
-      reinterpret_cast<event_base*>(GetEventLoop(*event_loop_)),
-      [](struct evconnlistener* listener, evutil_socket_t socket,
-         struct sockaddr* addr, int socklen, void* d) {
-        auto* context = reinterpret_cast<TcpServer*>(d);
-        RunTask(context->ListenerCallback(
-            reinterpret_cast<EvconnListener*>(listener), socket,
-            static_cast<void*>(addr), socklen));
+void TcpServer::Listen(Config config, bool reuse_port) {
+  if (config.use_io_uring) {
+#ifdef CORO_HTTP_IO_URING
+    for (auto& shard : shards_) {
+      shard->io_uring.reset(new IoUring(shard->event_loop));
+    }
+    if (acceptor_) {
+      acceptor_->io_uring.reset(new IoUring(event_loop_));
+    }
+#else
+    throw InvalidArgument("TcpServer built without io_uring support");
+#endif
+  }
+  if (acceptor_) {
+    Listen(acceptor_.get(), config, /*reuse_port=*/false);
+    return;
+  }
+  for (auto& shard : shards_) {
+    Listen(shard.get(), config, reuse_port);
+    // With port 0 the first listener picks the port the others share.
+    config.port = GetPort();
+  }
+}
+
+void TcpServer::Listen(Shard* shard, const Config& config, bool reuse_port) {
+#ifdef CORO_HTTP_IO_URING
+  if (shard->io_uring) {
+    shard->listen_fd = CreateSocket(config, reuse_port);
+    shard->event_loop->RunOnEventLoop(
+        [shard] { shard->connections.Spawn(shard->server->Accept(shard)); });
+    return;
+  }
+#endif
+  evconnlistener* listener = CreateListener(
+      reinterpret_cast<event_base*>(GetEventLoop(*shard->event_loop)), config,
+      reuse_port ? LEV_OPT_REUSEABLE_PORT : 0,
+      [](struct evconnlistener*, evutil_socket_t socket, struct sockaddr*, int,
+         void* d) {
+        auto* shard = reinterpret_cast<Shard*>(d);
+        shard->server->OnAccepted(shard, socket);
       },
-      this, LEV_OPT_REUSEABLE | LEV_OPT_CLOSE_ON_FREE,
-      /*backlog=*/-1, &d.sockaddr, sizeof(sockaddr_in));
-  if (listener == nullptr) {
-    throw RuntimeError("evconnlistener_new_bind error");
+      shard);
+  shard->listener =
+      EvconnListenerPtr(reinterpret_cast<EvconnListener*>(listener));
+}
+
+void TcpServer::OnAccepted(Shard* shard, socket_t fd) {
+  if (shard != acceptor_.get()) {
+    Serve(shard, fd);
+    return;
   }
-  return std::unique_ptr<EvconnListener, EvconnListenerDeleter>(
-      reinterpret_cast<EvconnListener*>(listener));
+  Shard* target = shards_[next_shard_++ % shards_.size()].get();
+  target->event_loop->RunOnEventLoop(
+      [target, fd] { target->server->Serve(target, fd); });
 }
 
-Task<> TcpServer::ListenerCallback(struct EvconnListener*, evutil_socket_t fd,
-                                   void*, int socklen) noexcept {
+void TcpServer::Serve(Shard* shard, socket_t fd) {
+#ifdef CORO_HTTP_IO_URING
+  if (shard->io_uring) {
+    shard->connections.Spawn(ServeWithIoUring(shard, fd));
+    return;
+  }
+#endif
+  shard->connections.Spawn(ListenerCallback(shard, fd));
+}
+
+Task<> TcpServer::ListenerCallback(Shard* shard, evutil_socket_t fd) noexcept {
   RequestContext context{};
+  connection_count_++;
+  auto guard = AtScopeExit([&] { connection_count_--; });
   try {
     if (quitting_) {
+      evutil_closesocket(fd);
       co_return;
     }
-    current_connections_++;
-    auto scope_guard = AtScopeExit([&] {
-      current_connections_--;
-      if (quitting_ && current_connections_ == 0) {
-        OnQuit();
-      }
-    });
-    stdx::stop_callback stop_callback1(
-        stop_source_.get_token(), [&] { context.stop_source.request_stop(); });
-    stdx::stop_callback stop_callback2(context.stop_source.get_token(), [&] {
-      context.read_semaphore.SetException(InterruptedException());
-    });
-    stdx::stop_callback stop_callback3(context.stop_source.get_token(), [&] {
-      context.write_semaphore.SetException(InterruptedException());
-    });
+    stdx::stop_token connections_token = shard->connections.get_token();
+    context.stop_source = stdx::stop_source(connections_token.deadline());
+    stdx::stop_callback stop_callback(
+        std::move(connections_token),
+        [&] { context.stop_source.request_stop(); });
     auto bev = CreateBufferEvent(
-        reinterpret_cast<event_base*>(GetEventLoop(*event_loop_)), fd,
+        reinterpret_cast<event_base*>(GetEventLoop(*shard->event_loop)), fd,
         &context);
     while (true) {
       auto response = request_handler_(GetRequestContent(bev.get(), &context),
                                        context.stop_source.get_token());
       FOR_CO_AWAIT(TcpResponseChunk ctl, response) {
         if (!ctl.chunk().empty()) {
-          co_await Write(&context, bev.get(), std::move(ctl));
+          auto written = co_await Write(&context, bev.get(), std::move(ctl));
+          if (!written) {
+            context.stop_source.request_stop();
+            co_return;
+          }
         }
       }
+      // Give other connections a turn before serving a pipelined request.
+      // Otherwise the next read suspends anyway.
+      if (evbuffer_get_length(bufferevent_get_input(bev.get())) > 0) {
+        co_await shard->event_loop->Yield();
+      }
+    }
+  } catch (const InterruptedException&) {
+    context.stop_source.request_stop();
+  } catch (const Exception& e) {
+    std::cerr << "[TCP_SERVER]: " << e.what() << '\n';
+    context.stop_source.request_stop();
+  }
+}
+
+#ifdef CORO_HTTP_IO_URING
+
+Task<> TcpServer::Accept(Shard* shard) noexcept {
+  auto close_socket = AtScopeExit([&] { close(shard->listen_fd); });
+  stdx::stop_token stop_token = shard->connections.get_token();
+  try {
+    IoUring::Acceptor acceptor(shard->io_uring.get(), shard->listen_fd);
+    while (true) {
+      auto fd = co_await AsExpected(acceptor.Accept(stop_token));
+      if (fd) {
+        OnAccepted(shard, *fd);
+        continue;
+      }
+      if (fd.error().interrupted()) {
+        co_return;
+      }
+      try {
+        fd.value();
+      } catch (const Exception& e) {
+        std::cerr << "[TCP_SERVER]: " << e.what() << '\n';
+      }
+      // Running out of file descriptors mustn't turn into a busy loop.
+      (co_await AsExpected(shard->event_loop->Wait(100, stop_token))).value();
+    }
+  } catch (const InterruptedException&) {
+  } catch (const Exception& e) {
+    std::cerr << "[TCP_SERVER]: " << e.what() << '\n';
+  }
+}
+
+Task<> TcpServer::ServeWithIoUring(Shard* shard, socket_t fd) noexcept {
+  IoUringContext context;
+  context.io_uring = shard->io_uring.get();
+  context.fd = fd;
+  connection_count_++;
+  auto guard = AtScopeExit([&] {
+    close(fd);
+    connection_count_--;
+  });
+  try {
+    if (quitting_) {
+      co_return;
+    }
+    stdx::stop_token connections_token = shard->connections.get_token();
+    context.stop_source = stdx::stop_source(connections_token.deadline());
+    stdx::stop_callback stop_callback(
+        std::move(connections_token),
+        [&] { context.stop_source.request_stop(); });
+    while (true) {
+      auto response = request_handler_(GetRequestContent(&context),
+                                       context.stop_source.get_token());
+      FOR_CO_AWAIT(TcpResponseChunk ctl, response) {
+        if (!ctl.chunk().empty()) {
+          auto sent = co_await Send(&context, std::move(ctl));
+          if (!sent) {
+            context.stop_source.request_stop();
+            co_return;
+          }
+        }
+      }
+      // Give other connections a turn before serving a pipelined request.
+      // Otherwise the next receive suspends anyway.
+      if (!context.pending.empty()) {
+        co_await shard->event_loop->Yield();
+      }
     }
   } catch (const InterruptedException&) {
     context.stop_source.request_stop();
@@ -269,4 +556,6 @@ Task<> TcpServer::ListenerCallback(struct EvconnListener*, evutil_socket_t fd,
   }
 }
 
+#endif  // CORO_HTTP_IO_URING
+
 }  // namespace coro::util
\ No newline at end of file
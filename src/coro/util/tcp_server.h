@@ -1,21 +1,28 @@
 #ifndef CORO_UTIL_BASE_SERVER_H
 #define CORO_UTIL_BASE_SERVER_H
 
+#include <atomic>
 #include <span>
 #include <variant>
+#include <vector>
 
+#include "coro/async_scope.h"
 #include "coro/generator.h"
 #include "coro/promise.h"
 #include "coro/stdx/any_invocable.h"
 #include "coro/stdx/stop_token.h"
 #include "coro/util/event_loop.h"
+#include "coro/util/event_loop_group.h"
 
 namespace coro::util {
 
+class IoUring;
+
 inline constexpr uint32_t kMaxBufferSize = 4 * 1024;
 
 using TcpRequestDataProvider =
-    stdx::any_invocable<Task<std::vector<uint8_t>>(uint32_t byte_cnt)>;
+    stdx::any_invocable<Task<std::vector<uint8_t>>(uint32_t byte_cnt),
+                        stdx::any_invocable_hot_path_buffer_size>;
 
 class TcpResponseChunk {
  public:
@@ -33,14 +40,36 @@ using TcpRequestHandler = stdx::any_invocable<Generator<TcpResponseChunk>(
 
 class TcpServer {
  public:
+  // How connections get spread over the event loops of an EventLoopGroup.
+  enum class Distribution {
+    // Each event loop accepts on its own SO_REUSEPORT listener, the kernel
+    // balances the connections.
+    kReusePort,
+    // A single listener on the server's event loop hands accepted sockets to
+    // the group's event loops in turns.
+    kRoundRobin,
+  };
+
   struct Config {
     std::string address;
     uint16_t port;
+    Distribution distribution = Distribution::kReusePort;
+    // Accepts and serves connections through an io_uring per event loop
+    // instead of libevent's bufferevents. Linux only, the constructor throws
+    // unless the library was built with WITH_IO_URING.
+    bool use_io_uring = false;
   };
 
   TcpServer(TcpRequestHandler request_handler, const EventLoop* event_loop,
             const Config& config);
 
+  // Serves connections on the event loops of `group`. A connection's
+  // coroutines never leave the event loop it was assigned to, but
+  // `request_handler` gets invoked concurrently from all of them. GetPort and
+  // Quit have to be called on `event_loop`.
+  TcpServer(TcpRequestHandler request_handler, const EventLoop* event_loop,
+            const EventLoopGroup* group, const Config& config);
+
   TcpServer(const TcpServer&) = delete;
   TcpServer(TcpServer&&) = delete;
 
@@ -50,6 +79,8 @@ class TcpServer {
   uint16_t GetPort() const;
   Task<> Quit();
 
+  size_t connection_count() const { return connection_count_; }
+
  private:
   struct EvconnListener;
 
@@ -57,25 +88,53 @@ class TcpServer {
     void operator()(EvconnListener* listener) const noexcept;
   };
 
+  struct IoUringDeleter {
+    void operator()(IoUring* io_uring) const noexcept;
+  };
+
 #ifdef _WIN32
   using socket_t = intptr_t;
 #else
   using socket_t = int;
 #endif
 
-  std::unique_ptr<EvconnListener, EvconnListenerDeleter> CreateListener(
-      const Config& config);
-  Task<> ListenerCallback(EvconnListener*, socket_t fd, void* sockaddr,
-                          int socklen) noexcept;
-  void OnQuit();
+  using EvconnListenerPtr =
+      std::unique_ptr<EvconnListener, EvconnListenerDeleter>;
+
+  // Connections served by one event loop. Only touched on that event loop.
+  struct Shard {
+    Shard(TcpServer* server, const EventLoop* event_loop)
+        : server(server), event_loop(event_loop) {}
+
+    TcpServer* server;
+    const EventLoop* event_loop;
+    AsyncScope connections;
+    EvconnListenerPtr listener;
+    std::unique_ptr<IoUring, IoUringDeleter> io_uring;
+    // Listening socket when accepting through `io_uring`.
+    socket_t listen_fd = -1;
+  };
+
+  void Listen(Config config, bool reuse_port);
+  void Listen(Shard* shard, const Config& config, bool reuse_port);
+  void OnAccepted(Shard* shard, socket_t fd);
+  void Serve(Shard* shard, socket_t fd);
+  Task<> ListenerCallback(Shard* shard, socket_t fd) noexcept;
+  Task<> Accept(Shard* shard) noexcept;
+  Task<> ServeWithIoUring(Shard* shard, socket_t fd) noexcept;
+  Task<> StopShard(Shard* shard);
+  Task<> QuitShard(Shard* shard);
 
   TcpRequestHandler request_handler_;
   const coro::util::EventLoop* event_loop_;
-  bool quitting_ = false;
-  int current_connections_ = 0;
-  stdx::stop_source stop_source_;
+  std::atomic<bool> quitting_ = false;
+  std::atomic<size_t> connection_count_ = 0;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  size_t next_shard_ = 0;
+  size_t running_shard_count_ = 0;
   Promise<void> quit_semaphore_;
-  std::unique_ptr<EvconnListener, EvconnListenerDeleter> listener_;
+  // Accepts the connections in the Distribution::kRoundRobin mode.
+  std::unique_ptr<Shard> acceptor_;
 };
 
 Task<> DrainTcpDataProvider(TcpRequestDataProvider);
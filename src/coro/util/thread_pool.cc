@@ -13,8 +13,14 @@
 #include <pthread.h>
 #endif
 
+#include <event2/event.h>
+
+#include <algorithm>
+#include <array>
 #include <string>
 
+#include "coro/exception.h"
+
 namespace coro::util {
 
 namespace {
@@ -73,59 +79,470 @@ std::string PadValue(unsigned int d, int cnt) {
   return result;
 }
 
+// Rounds of looking for work before an idle worker parks.
+constexpr int kSpinCount = 64;
+
+// Pending events keep the event loop from exiting on empty. The timeout is
+// there just to make the event pending, firing it is harmless.
+void AddKeepAliveEvent(void* event) {
+  timeval tv = {};
+  tv.tv_sec = 3600;
+  if (event_add(static_cast<struct event*>(event), &tv) != 0) {
+    throw RuntimeError("can't add thread pool event");
+  }
+}
+
 }  // namespace
 
 void SetThreadName(std::string_view name) {
   SetThreadNameImpl(std::string(name));
 }
 
+struct ThreadPool::Job {
+  enum class State { kIdle, kQueued, kRunning, kCancelled };
+
+  stdx::coroutine_handle<void> handle;
+  std::atomic<State> state = State::kIdle;
+  // Held by the awaiter and by the queue the job sits in.
+  std::atomic<int> ref_count = 1;
+};
+
+// Bounded queue of a single worker. Only the owning worker pushes, while any
+// worker may pop, always from the front.
+class ThreadPool::Worker {
+ public:
+  static constexpr uint64_t kCapacity = 256;
+
+  Worker(ThreadPool* thread_pool, size_t index)
+      : thread_pool(thread_pool), index(index) {}
+
+  // Fails when the queue is full.
+  bool Push(Job* job) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == kCapacity) {
+      return false;
+    }
+    jobs_[tail % kCapacity].store(job, std::memory_order_relaxed);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  Job* Pop() {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    while (head != tail_.load(std::memory_order_acquire)) {
+      // The slot may get overwritten right after the load, but then `head_`
+      // moved on as well and the exchange below fails.
+      Job* job = jobs_[head % kCapacity].load(std::memory_order_relaxed);
+      if (head_.compare_exchange_weak(head, head + 1,
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+        return job;
+      }
+    }
+    return nullptr;
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+  ThreadPool* thread_pool;
+  size_t index;
+  std::thread thread;
+  // Guarded by `ThreadPool::workers_mutex_`.
+  bool active = false;
+
+ private:
+  alignas(64) std::atomic<uint64_t> head_ = 0;
+  alignas(64) std::atomic<uint64_t> tail_ = 0;
+  std::array<std::atomic<Job*>, kCapacity> jobs_ = {};
+};
+
+thread_local ThreadPool::Worker* ThreadPool::current_worker_ = nullptr;
+
+ThreadPool::ScheduleTask::ScheduleTask(ThreadPool* thread_pool,
+                                                 Priority priority)
+    : thread_pool_(thread_pool), priority_(priority), job_(new Job) {}
+
+ThreadPool::ScheduleTask::~ScheduleTask() { Release(job_); }
+
+bool ThreadPool::ScheduleTask::await_suspend(
+    stdx::coroutine_handle<void> handle) {
+  // Once queued, the coroutine may be resumed and the awaiter destroyed
+  // before Submit returns.
+  ThreadPool* thread_pool = thread_pool_;
+  Priority priority = priority_;
+  Job* job = job_;
+  job->handle = handle;
+  job->ref_count.fetch_add(1, std::memory_order_relaxed);
+  auto state = Job::State::kIdle;
+  if (!job->state.compare_exchange_strong(state, Job::State::kQueued,
+                                          std::memory_order_acq_rel)) {
+    // Stopped before it got queued.
+    job->ref_count.fetch_sub(1, std::memory_order_relaxed);
+    return false;
+  }
+  thread_pool->Submit(job, priority);
+  return true;
+}
+
+void ThreadPool::ScheduleTask::Cancel() {
+  auto state = Job::State::kIdle;
+  if (job_->state.compare_exchange_strong(state, Job::State::kCancelled,
+                                          std::memory_order_acq_rel)) {
+    return;
+  }
+  if (state == Job::State::kQueued &&
+      job_->state.compare_exchange_strong(state, Job::State::kCancelled,
+                                          std::memory_order_acq_rel)) {
+    // The worker which pops the job just drops it.
+    job_->handle.resume();
+  }
+}
+
+bool ThreadPool::ScheduleTask::interrupted() const {
+  return job_->state.load(std::memory_order_acquire) ==
+         Job::State::kCancelled;
+}
+
 ThreadPool::ThreadPool(const EventLoop* event_loop, unsigned int thread_count,
                        std::string name)
-    : event_loop_(event_loop), name_(std::move(name)) {
-  const int cnt = GetDigitCount(thread_count);
-  for (unsigned int i = 0; i < thread_count; i++) {
-    threads_.emplace_back([&, i, cnt] {
-      SetThreadName(name_ + "-" + PadValue(i, cnt));
-      Work();
-    });
+    : ThreadPool(event_loop,
+                 Config{.min_thread_count = std::max(thread_count, 1u),
+                        .max_thread_count = std::max(thread_count, 1u),
+                        .name = std::move(name)}) {}
+
+ThreadPool::ThreadPool(const EventLoop* event_loop, Config config)
+    : config_(std::move(config)),
+      event_loop_(event_loop),
+      completion_event_(event_new(
+          reinterpret_cast<struct event_base*>(GetEventLoop(*event_loop)), -1,
+          EV_PERSIST,
+          [](evutil_socket_t, short, void* d) {
+            static_cast<ThreadPool*>(d)->DrainCompletions();
+          },
+          this)) {
+  if (!completion_event_) {
+    throw RuntimeError("event_new error");
+  }
+  config_.min_thread_count = std::max(config_.min_thread_count, 1u);
+  config_.max_thread_count =
+      std::max(config_.max_thread_count, config_.min_thread_count);
+  for (unsigned int i = 0; i < config_.max_thread_count; i++) {
+    workers_.emplace_back(std::make_unique<Worker>(this, i));
+  }
+  if (config_.max_pending_job_count > 0) {
+    for (Lane& lane : lanes_) {
+      lane.admission.emplace(
+          static_cast<int64_t>(config_.max_pending_job_count));
+    }
+  }
+  for (unsigned int i = 0; i < config_.min_thread_count; i++) {
+    StartWorker();
   }
 }
 
 ThreadPool::~ThreadPool() {
+  // Workers may still start or retire others until they see `quit_`, both
+  // under `workers_mutex_`, which can't be held while joining them.
+  std::vector<std::thread> threads;
   {
-    std::unique_lock lock(mutex_);
+    std::unique_lock lock(workers_mutex_);
     quit_ = true;
+    for (auto& worker : workers_) {
+      if (worker->thread.joinable()) {
+        threads.push_back(std::move(worker->thread));
+      }
+    }
+  }
+  {
+    std::unique_lock lock(mutex_);
     condition_variable_.notify_all();
   }
-  for (auto& thread : threads_) {
+  for (std::thread& thread : threads) {
     thread.join();
   }
 }
 
-void ThreadPool::Work() {
+auto ThreadPool::Schedule(Priority priority) -> ScheduleTask {
+  return ScheduleTask(this, priority);
+}
+
+bool ThreadPool::TryAdmit(Priority priority) {
+  Lane& l = lane(priority);
+  return !l.admission || l.admission->TryAcquire();
+}
+
+void ThreadPool::StartWorker() {
+  std::unique_lock lock(workers_mutex_);
+  if (quit_ || active_count_ >= config_.max_thread_count) {
+    return;
+  }
+  auto it = std::find_if(workers_.begin(), workers_.end(),
+                         [](const auto& worker) { return !worker->active; });
+  Worker* worker = it->get();
+  if (worker->thread.joinable()) {
+    // Retired already, it just has to finish exiting.
+    worker->thread.join();
+  }
+  worker->active = true;
+  active_count_++;
+  searching_count_++;
+  const int cnt = GetDigitCount(config_.max_thread_count);
+  worker->thread = std::thread([this, worker, cnt] {
+    SetThreadName(config_.name + "-" +
+                  PadValue(static_cast<unsigned int>(worker->index), cnt));
+#ifdef __linux__
+    if (!config_.cpus.empty()) {
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      CPU_SET(config_.cpus[worker->index % config_.cpus.size()], &cpu_set);
+      // Best effort, the CPU may be offline or outside of the cgroup.
+      pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    }
+#endif
+    Work(worker);
+  });
+}
+
+bool ThreadPool::Retire(Worker* worker) {
+  std::unique_lock lock(workers_mutex_);
+  if (active_count_ <= config_.min_thread_count || HasWork()) {
+    return false;
+  }
+  worker->active = false;
+  active_count_--;
+  searching_count_--;
+  return true;
+}
+
+void ThreadPool::Work(Worker* worker) {
+  current_worker_ = worker;
   while (true) {
-    std::unique_lock lock(mutex_);
-    condition_variable_.wait(lock, [&] { return !tasks_.empty() || quit_; });
-    if (quit_ && tasks_.empty()) {
+    Job* job = nullptr;
+    for (int i = 0; i < kSpinCount && !job; i++) {
+      job = FindJob(worker);
+      if (!job) {
+        std::this_thread::yield();
+      }
+    }
+    if (job) {
+      // The last worker looking for jobs is about to get busy, someone else
+      // has to take care of the ones left behind.
+      if (searching_count_.fetch_sub(1) == 1 && HasWork() &&
+          active_count_ < config_.max_thread_count) {
+        StartWorker();
+      }
+      Run(job);
+      searching_count_++;
+    } else if (quit_) {
       break;
+    } else if (!Park() && Retire(worker)) {
+      break;
+    }
+  }
+  current_worker_ = nullptr;
+}
+
+auto ThreadPool::FindJob(Worker* worker) -> Job* {
+  if (Job* job = worker->Pop()) {
+    return job;
+  }
+  if (Job* job = TakeInjected(Priority::kLatencySensitive, worker)) {
+    return job;
+  }
+  // Each worker starts stealing from its right-hand neighbour, to spread
+  // the thieves over the victims. Retired workers leave empty queues behind.
+  for (size_t i = 1; i < workers_.size(); i++) {
+    if (Job* job = workers_[(worker->index + i) % workers_.size()]->Pop()) {
+      return job;
+    }
+  }
+  return TakeInjected(Priority::kBulk, worker);
+}
+
+auto ThreadPool::TakeInjected(Priority priority, Worker* worker) -> Job* {
+  Lane& l = lane(priority);
+  if (l.injected_count.load(std::memory_order_acquire) == 0) {
+    return nullptr;
+  }
+  std::unique_lock lock(l.mutex);
+  if (l.injected.empty()) {
+    return nullptr;
+  }
+  Job* job = l.injected.front();
+  l.injected.pop_front();
+  // Takes a fair share of the backlog, so that the next batch doesn't have
+  // to go through the lock again while the others get their part too. Bulk
+  // jobs are taken one by one instead, local queues are checked first and
+  // latency sensitive jobs mustn't end up behind them.
+  if (priority == Priority::kLatencySensitive) {
+    size_t count = std::min(
+        {l.injected.size(),
+         l.injected.size() / std::max(active_count_.load(), 1u) + 1,
+         size_t{Worker::kCapacity / 2}});
+    for (size_t i = 0; i < count && worker->Push(l.injected.front()); i++) {
+      l.injected.pop_front();
+    }
+  }
+  l.injected_count.store(l.injected.size(), std::memory_order_release);
+  return job;
+}
+
+bool ThreadPool::HasWork() {
+  for (Lane& l : lanes_) {
+    if (l.injected_count.load(std::memory_order_seq_cst) > 0) {
+      return true;
+    }
+  }
+  for (const auto& worker : workers_) {
+    if (!worker->empty()) {
+      return true;
     }
-    auto coroutine = tasks_.back();
-    tasks_.pop_back();
-    lock.unlock();
-    coroutine.resume();
+  }
+  return false;
+}
+
+bool ThreadPool::Park() {
+  uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+  parked_count_.fetch_add(1, std::memory_order_seq_cst);
+  // Either this sees a job submitted concurrently, or the submitter sees the
+  // parked worker and notifies it.
+  bool woken = true;
+  if (!HasWork() && !quit_) {
+    std::unique_lock lock(mutex_);
+    auto woken_up = [&] {
+      return epoch_.load(std::memory_order_seq_cst) != epoch || quit_;
+    };
+    if (active_count_ > config_.min_thread_count) {
+      woken =
+          condition_variable_.wait_for(lock, config_.idle_timeout, woken_up);
+    } else {
+      condition_variable_.wait(lock, woken_up);
+    }
+  }
+  parked_count_.fetch_sub(1, std::memory_order_relaxed);
+  return woken;
+}
+
+void ThreadPool::Submit(Job* job, Priority priority) {
+  // Jobs submitted by a worker of this pool go to its own queue, skipping the
+  // lane's lock; idle workers steal them from there. Bulk jobs always go
+  // through the lane, so that they never get ahead of latency sensitive ones.
+  Worker* worker = current_worker_;
+  if (!worker || worker->thread_pool != this ||
+      priority != Priority::kLatencySensitive || !worker->Push(job)) {
+    Lane& l = lane(priority);
+    std::unique_lock lock(l.mutex);
+    l.injected.push_back(job);
+    l.injected_count.store(l.injected.size(), std::memory_order_seq_cst);
+  }
+  Notify();
+  if (searching_count_ == 0 && active_count_ < config_.max_thread_count) {
+    StartWorker();
+  }
+}
+
+void ThreadPool::Notify() {
+  epoch_.fetch_add(1, std::memory_order_seq_cst);
+  if (parked_count_.load(std::memory_order_seq_cst) > 0) {
+    std::unique_lock lock(mutex_);
+    condition_variable_.notify_one();
+  }
+}
+
+void ThreadPool::Run(Job* job) {
+  auto state = Job::State::kQueued;
+  bool claimed = job->state.compare_exchange_strong(
+      state, Job::State::kRunning, std::memory_order_acq_rel);
+  stdx::coroutine_handle<void> handle = job->handle;
+  Release(job);
+  if (claimed) {
+    handle.resume();
+  }
+}
+
+void ThreadPool::Release(Job* job) {
+  if (job->ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete job;
+  }
+}
+
+void ThreadPool::EventDeleter::operator()(void* event) const {
+  event_free(static_cast<struct event*>(event));
+}
+
+ThreadPool::InFlightJob::InFlightJob(ThreadPool* thread_pool,
+                                     Priority priority)
+    : thread_pool_(thread_pool), priority_(priority) {
+  if (thread_pool_->in_flight_count_.fetch_add(1) == 0) {
+    AddKeepAliveEvent(thread_pool_->completion_event_.get());
   }
 }
 
-Task<> ThreadPool::SwitchToEventLoop() {
-  struct Awaiter {
-    bool await_ready() const { return false; }
-    void await_resume() {}
-    void await_suspend(stdx::coroutine_handle<void> continuation) {
-      event_loop->RunOnEventLoop([=]() mutable { continuation.resume(); });
+ThreadPool::InFlightJob::~InFlightJob() {
+  if (auto& admission = thread_pool_->lane(priority_).admission) {
+    admission->Release();
+  }
+  if (thread_pool_->in_flight_count_.fetch_sub(1) == 1) {
+    auto* event =
+        static_cast<struct event*>(thread_pool_->completion_event_.get());
+    event_del(event);
+    // A job submitted from another thread in the meantime may have found the
+    // count at zero too, and added the event just before it got deleted.
+    if (thread_pool_->in_flight_count_.load() > 0) {
+      AddKeepAliveEvent(thread_pool_->completion_event_.get());
     }
-    const EventLoop* event_loop;
-  };
-  co_await Awaiter{event_loop_};
+  }
+}
+
+void ThreadPool::CompletionAwaiter::await_suspend(
+    stdx::coroutine_handle<void> handle) {
+  handle_ = handle;
+  ThreadPool* thread_pool = thread_pool_;
+  // Once published, the awaiter may be resumed and destroyed any time.
+  CompletionAwaiter* head =
+      thread_pool->completions_.load(std::memory_order_relaxed);
+  do {
+    next_ = head;
+  } while (!thread_pool->completions_.compare_exchange_weak(
+      head, this, std::memory_order_release, std::memory_order_relaxed));
+  if (head == nullptr) {
+    auto* event =
+        static_cast<struct event*>(thread_pool->completion_event_.get());
+    event_active(event, EV_READ, 0);
+  }
+}
+
+void ThreadPool::DrainCompletions() {
+  CompletionAwaiter* awaiter =
+      completions_.exchange(nullptr, std::memory_order_acquire);
+  CompletionAwaiter* reversed = nullptr;
+  size_t count = 0;
+  while (awaiter) {
+    CompletionAwaiter* next = awaiter->next_;
+    awaiter->next_ = reversed;
+    reversed = awaiter;
+    awaiter = next;
+    count++;
+  }
+  if (count == 0) {
+    return;
+  }
+  size_t bucket = 0;
+  while (bucket + 1 < completion_stats_.batch_count.size() &&
+         (size_t{2} << bucket) <= count) {
+    bucket++;
+  }
+  completion_stats_.batch_count[bucket]++;
+  completion_stats_.completion_count += count;
+  while (reversed) {
+    // Resuming the coroutine destroys the awaiter.
+    CompletionAwaiter* next = reversed->next_;
+    reversed->handle_.resume();
+    reversed = next;
+  }
 }
 
 }  // namespace coro::util
@@ -1,14 +1,22 @@
 #ifndef CORO_UTIL_THREAD_POOL_H
 #define CORO_UTIL_THREAD_POOL_H
 
-#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <concepts>
 #include <condition_variable>
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <thread>
 #include <type_traits>
 #include <vector>
 
+#include "coro/expected.h"
 #include "coro/promise.h"
+#include "coro/semaphore.h"
 #include "coro/task.h"
 #include "coro/util/event_loop.h"
 #include "coro/util/function_traits.h"
@@ -17,12 +25,64 @@ namespace coro::util {
 
 void SetThreadName(std::string_view thread_name);
 
+// Runs jobs on worker threads and resumes the awaiting coroutine back on
+// `event_loop`. Do and DoExpected have to be called on the event loop's
+// thread.
+//
+// Every worker owns a bounded lock-free FIFO queue, which the other workers
+// steal from once they run out of work. Jobs are submitted to a shared FIFO
+// injection queue per priority, workers move latency sensitive ones to their
+// own queues in batches. Idle workers spin for a while before they park.
+//
+// Finished jobs are handed back to the event loop through a lock-free list
+// of awaiters. Only the completion which finds the list empty wakes the
+// event loop up, which then resumes the whole batch at once. While jobs are
+// in flight, the event loop doesn't exit on empty.
+//
+// Bulk jobs are picked up only once there are no latency sensitive ones left
+// anywhere. Extra workers are started while all the others are busy, so a
+// flood of bulk jobs doesn't hold latency sensitive ones up for long either.
 class ThreadPool {
  public:
+  enum class Priority {
+    // Jobs somebody is waiting on, e.g. to answer a request.
+    kLatencySensitive,
+    // Throughput oriented work, like hashing or compressing big files.
+    kBulk,
+  };
+
+  class ScheduleTask;
+
+  struct Config {
+    // Workers kept even when idle.
+    unsigned int min_thread_count = std::thread::hardware_concurrency();
+    // Workers above `min_thread_count` are started while all the others are
+    // busy, and stop after being idle for `idle_timeout`.
+    unsigned int max_thread_count = std::thread::hardware_concurrency();
+    std::chrono::milliseconds idle_timeout = std::chrono::seconds(10);
+    // Jobs of one priority which may be queued or running at once. Once
+    // reached, Do suspends the caller until one of them finishes. Zero means
+    // no limit.
+    size_t max_pending_job_count = 0;
+    // Worker `i` is pinned to CPU `cpus[i % cpus.size()]`, Linux only.
+    // Listing the CPUs of a single NUMA node keeps the workers on it.
+    std::vector<int> cpus;
+    std::string name = "coro-tpool";
+  };
+
+  // Counts of completion batches resumed by the event loop, by size.
+  // `batch_count[i]` is the number of batches of [2^i, 2^(i+1)) completions,
+  // the last bucket also takes all bigger batches.
+  struct CompletionStats {
+    std::array<uint64_t, 16> batch_count;
+    uint64_t completion_count;
+  };
+
   explicit ThreadPool(
       const EventLoop* event_loop,
       unsigned int thread_count = std::thread::hardware_concurrency(),
       std::string name = "coro-tpool");
+  ThreadPool(const EventLoop* event_loop, Config config);
   ~ThreadPool();
 
   ThreadPool(const ThreadPool&) = delete;
@@ -30,41 +90,26 @@ class ThreadPool {
   ThreadPool& operator=(const ThreadPool&) = delete;
   ThreadPool& operator=(ThreadPool&&) = delete;
 
-  template <typename T>
-  using TaskT = std::conditional_t<std::is_void_v<T>, Task<>, Task<T>>;
+  template <typename Func, typename... Args>
+  ValueTask<util::ReturnTypeT<std::decay_t<Func>>> Do(
+      Priority priority, stdx::stop_token stop_token, Func&& func,
+      Args&&... args) {
+    return ValueTask<util::ReturnTypeT<std::decay_t<Func>>>(
+        DoExpected(priority, std::move(stop_token), std::forward<Func>(func),
+                   std::forward<Args>(args)...));
+  }
+
+  template <typename Func, typename... Args>
+    requires std::invocable<Func, Args...>
+  auto Do(Priority priority, Func&& func, Args&&... args) {
+    return Do(priority, stdx::stop_token(), std::forward<Func>(func),
+              std::forward<Args>(args)...);
+  }
 
   template <typename Func, typename... Args>
-  TaskT<util::ReturnTypeT<Func>> Do(stdx::stop_token stop_token, Func&& func,
-                                    Args&&... args) {
-    ThreadLoopAwaiter awaiter{this, stdx::coroutine_handle<void>(), false};
-    stdx::stop_callback cb(std::move(stop_token), [&] {
-      std::unique_lock lock(mutex_);
-      if (auto it =
-              std::find(tasks_.begin(), tasks_.end(), awaiter.continuation);
-          it != tasks_.end()) {
-        tasks_.erase(it);
-        lock.unlock();
-        awaiter.interrupted = true;
-        awaiter.continuation.resume();
-      }
-    });
-    co_await awaiter;
-    std::exception_ptr exception;
-    try {
-      if constexpr (std::is_void_v<util::ReturnTypeT<Func>>) {
-        std::forward<Func>(func)(std::forward<Args>(args)...);
-        co_await SwitchToEventLoop();
-        co_return;
-      } else {
-        auto result = std::forward<Func>(func)(std::forward<Args>(args)...);
-        co_await SwitchToEventLoop();
-        co_return result;
-      }
-    } catch (...) {
-      exception = std::current_exception();
-    }
-    co_await SwitchToEventLoop();
-    std::rethrow_exception(exception);
+  auto Do(stdx::stop_token stop_token, Func&& func, Args&&... args) {
+    return Do(Priority::kLatencySensitive, std::move(stop_token),
+              std::forward<Func>(func), std::forward<Args>(args)...);
   }
 
   template <typename... Args>
@@ -72,37 +117,211 @@ class ThreadPool {
     return Do(stdx::stop_token(), std::forward<Args>(args)...);
   }
 
+  // Like Do, but reports failures without throwing. Interruption in
+  // particular doesn't create an exception at all.
+  //
+  // Like with std::thread, `func` and `args` are copied into the task, so
+  // it may outlive the expression which created it.
+  template <typename Func, typename... Args>
+  Task<Expected<util::ReturnTypeT<Func>>> DoExpected(
+      Priority priority, stdx::stop_token stop_token, Func func,
+      Args... args);
+
+  template <typename Func, typename... Args>
+    requires std::invocable<Func, Args...>
+  auto DoExpected(Priority priority, Func&& func, Args&&... args) {
+    return DoExpected(priority, stdx::stop_token(), std::forward<Func>(func),
+                      std::forward<Args>(args)...);
+  }
+
+  template <typename Func, typename... Args>
+  auto DoExpected(stdx::stop_token stop_token, Func&& func, Args&&... args) {
+    return DoExpected(Priority::kLatencySensitive, std::move(stop_token),
+                      std::forward<Func>(func), std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  auto DoExpected(Args&&... args) {
+    return DoExpected(stdx::stop_token(), std::forward<Args>(args)...);
+  }
+
+  // Moves the awaiting coroutine onto one of the workers, may be awaited on
+  // any thread. Get back with `co_await event_loop->Schedule()`. Unlike Do,
+  // neither keeps the event loop from exiting on empty nor counts against
+  // Config::max_pending_job_count.
+  ScheduleTask Schedule(Priority priority = Priority::kLatencySensitive);
+
+  // Has to be called on the event loop's thread.
+  CompletionStats completion_stats() const { return completion_stats_; }
+
+  // Number of running workers.
+  unsigned int thread_count() const { return active_count_; }
+
+  // Jobs of `priority` waiting in the shared injection queue, i.e. not moved
+  // to a worker's own queue yet.
+  size_t injected_count(Priority priority) const {
+    return lanes_[static_cast<size_t>(priority)].injected_count;
+  }
+
  private:
-  void Work();
-  Task<> SwitchToEventLoop();
-
-  struct ThreadLoopAwaiter {
-    static bool await_ready() { return false; }
-    void await_resume() const {
-      if (interrupted) {
-        throw InterruptedException();
-      }
-    }
-    void await_suspend(stdx::coroutine_handle<void> handle) {
-      std::unique_lock lock(thread_pool->mutex_);
-      continuation = handle;
-      thread_pool->tasks_.emplace_back(handle);
-      thread_pool->condition_variable_.notify_one();
-    }
-    ThreadPool* thread_pool;
-    stdx::coroutine_handle<void> continuation;
-    bool interrupted;
+  struct Job;
+  class Worker;
+
+  struct EventDeleter {
+    void operator()(void* event) const;
+  };
+
+  struct Lane {
+    std::deque<Job*> injected;
+    std::mutex mutex;
+    // Size of `injected`, readable without taking the lock.
+    std::atomic<size_t> injected_count = 0;
+    // Admits Config::max_pending_job_count jobs at once.
+    std::optional<Semaphore> admission;
+  };
+
+  // Keeps the event loop from exiting on empty while it exists, and gives
+  // the job's admission back once destroyed.
+  class InFlightJob {
+   public:
+    InFlightJob(ThreadPool* thread_pool, Priority priority);
+    ~InFlightJob();
+
+    InFlightJob(const InFlightJob&) = delete;
+    InFlightJob& operator=(const InFlightJob&) = delete;
+
+   private:
+    ThreadPool* thread_pool_;
+    Priority priority_;
+  };
+
+  // Resumes the awaiting coroutine on the event loop, together with the
+  // other completions queued until the event loop gets to them.
+  class CompletionAwaiter {
+   public:
+    explicit CompletionAwaiter(ThreadPool* thread_pool)
+        : thread_pool_(thread_pool) {}
+
+    bool await_ready() const { return false; }
+    void await_suspend(stdx::coroutine_handle<void> handle);
+    void await_resume() const {}
+
+   private:
+    friend class ThreadPool;
+
+    ThreadPool* thread_pool_;
+    stdx::coroutine_handle<void> handle_;
+    CompletionAwaiter* next_ = nullptr;
   };
 
-  std::vector<stdx::coroutine_handle<void>> tasks_;
-  std::vector<std::thread> threads_;
-  bool quit_ = false;
+  Lane& lane(Priority priority) {
+    return lanes_[static_cast<size_t>(priority)];
+  }
+
+  bool TryAdmit(Priority priority);
+  void StartWorker();
+  bool Retire(Worker* worker);
+  void Work(Worker* worker);
+  Job* FindJob(Worker* worker);
+  Job* TakeInjected(Priority priority, Worker* worker);
+  bool HasWork();
+  bool Park();
+  void Submit(Job* job, Priority priority);
+  void Notify();
+  void Run(Job* job);
+  static void Release(Job* job);
+  CompletionAwaiter SwitchToEventLoop() { return CompletionAwaiter(this); }
+  void DrainCompletions();
+
+  // Worker running on the current thread, if any.
+  static thread_local Worker* current_worker_;
+
+  Config config_;
+  // One slot per potential worker, allocated upfront so that thieves may
+  // scan them while the pool grows and shrinks.
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::mutex workers_mutex_;
+  std::atomic<unsigned int> active_count_ = 0;
+  // Active workers which aren't running a job at the moment.
+  std::atomic<unsigned int> searching_count_ = 0;
+  std::array<Lane, 2> lanes_;
+  // Bumped on every submission, parked workers wait for it to change.
+  std::atomic<uint64_t> epoch_ = 0;
+  std::atomic<unsigned> parked_count_ = 0;
+  std::atomic<bool> quit_ = false;
   std::condition_variable condition_variable_;
   std::mutex mutex_;
   const EventLoop* event_loop_;
-  std::string name_;
+  // Completions not resumed yet, the most recent one first.
+  std::atomic<CompletionAwaiter*> completions_ = nullptr;
+  std::unique_ptr<void, EventDeleter> completion_event_;
+  std::atomic<size_t> in_flight_count_ = 0;
+  CompletionStats completion_stats_ = {};
 };
 
+// Moves the awaiting coroutine onto one of the workers. Once cancelled
+// before a worker picked it up, the coroutine is resumed on the cancelling
+// thread instead.
+class ThreadPool::ScheduleTask {
+ public:
+  ScheduleTask(ThreadPool* thread_pool, Priority priority);
+  ~ScheduleTask();
+
+  ScheduleTask(const ScheduleTask&) = delete;
+  ScheduleTask& operator=(const ScheduleTask&) = delete;
+
+  bool await_ready() const { return false; }
+  bool await_suspend(stdx::coroutine_handle<void> handle);
+  void await_resume() const {}
+
+  void Cancel();
+  bool interrupted() const;
+
+ private:
+  ThreadPool* thread_pool_;
+  Priority priority_;
+  // Shared with the queue it sits in, which may outlive the awaiter.
+  Job* job_;
+};
+
+template <typename Func, typename... Args>
+Task<Expected<util::ReturnTypeT<Func>>> ThreadPool::DoExpected(
+    Priority priority, stdx::stop_token stop_token, Func func,
+    Args... args) {
+  if (!TryAdmit(priority)) {
+    auto admitted =
+        co_await AsExpected(lane(priority).admission->Acquire(stop_token));
+    if (!admitted) {
+      co_return admitted.error();
+    }
+  }
+  InFlightJob in_flight(this, priority);
+  ScheduleTask awaiter(this, priority);
+  stdx::stop_callback cb(std::move(stop_token), [&] { awaiter.Cancel(); });
+  co_await awaiter;
+  if (awaiter.interrupted()) {
+    // Resumed on the thread which requested the stop.
+    co_await SwitchToEventLoop();
+    co_return Unexpected::Interrupted();
+  }
+  std::exception_ptr exception;
+  try {
+    if constexpr (std::is_void_v<util::ReturnTypeT<Func>>) {
+      std::move(func)(std::move(args)...);
+      co_await SwitchToEventLoop();
+      co_return Expected<void>();
+    } else {
+      auto result = std::move(func)(std::move(args)...);
+      co_await SwitchToEventLoop();
+      co_return std::move(result);
+    }
+  } catch (...) {
+    exception = std::current_exception();
+  }
+  co_await SwitchToEventLoop();
+  co_return Unexpected(std::move(exception));
+}
+
 }  // namespace coro::util
 
 #endif  // CORO_UTIL_THREAD_POOL_H
@@ -0,0 +1,132 @@
+#include "coro/util/timer_wheel.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace coro::util {
+
+namespace {
+
+constexpr uint64_t kSlotMask = TimerWheel::kSlotCount - 1;
+constexpr int kHorizonBits = TimerWheel::kLevelBits * TimerWheel::kLevelCount;
+
+int Shift(int level) { return level * TimerWheel::kLevelBits; }
+
+}  // namespace
+
+void TimerWheel::Add(Timer* timer, uint64_t expiry) {
+  // Expiries beyond the horizon of the wheel get clamped.
+  timer->expiry_ =
+      std::min(expiry, now_ | ((uint64_t(1) << kHorizonBits) - 1));
+  Place(timer);
+  size_++;
+}
+
+void TimerWheel::Remove(Timer* timer) {
+  if (!timer->linked()) {
+    return;
+  }
+  List(timer).Remove(timer);
+  if (timer->level_ >= 0 && slots_[timer->level_][timer->slot_].empty()) {
+    occupied_[timer->level_] &= ~(uint64_t(1) << timer->slot_);
+  }
+  size_--;
+}
+
+void TimerWheel::Advance(uint64_t now) {
+  Expire(due_);
+  while (true) {
+    std::optional<uint64_t> next = NextSlotTick();
+    if (!next || *next > now) {
+      break;
+    }
+    now_ = *next;
+    for (int level = kLevelCount - 1; level > 0; level--) {
+      if ((now_ & ((uint64_t(1) << Shift(level)) - 1)) == 0) {
+        Cascade(level, (now_ >> Shift(level)) & kSlotMask);
+      }
+    }
+    int slot = now_ & kSlotMask;
+    occupied_[0] &= ~(uint64_t(1) << slot);
+    Expire(slots_[0][slot]);
+    // Cascaded timers expiring right at the boundary end up here.
+    Expire(due_);
+  }
+  now_ = std::max(now_, now);
+}
+
+std::optional<uint64_t> TimerWheel::NextTick() const {
+  if (!due_.empty()) {
+    return now_;
+  }
+  return NextSlotTick();
+}
+
+std::optional<uint64_t> TimerWheel::NextSlotTick() const {
+  std::optional<uint64_t> next;
+  for (int level = 0; level < kLevelCount; level++) {
+    // Timers at a level always have a greater digit than `now_` there, so
+    // only the slots past the current one are looked at.
+    uint64_t digit = (now_ >> Shift(level)) & kSlotMask;
+    uint64_t mask = occupied_[level] & ~((uint64_t(2) << digit) - 1);
+    if (mask == 0) {
+      continue;
+    }
+    uint64_t block = now_ >> Shift(level + 1) << Shift(level + 1);
+    uint64_t tick = block | (uint64_t(std::countr_zero(mask)) << Shift(level));
+    next = next ? std::min(*next, tick) : tick;
+  }
+  return next;
+}
+
+IntrusiveList<TimerWheel::Timer>& TimerWheel::List(const Timer* timer) {
+  switch (timer->level_) {
+    case kDueLevel:
+      return due_;
+    case kFiringLevel:
+      return firing_;
+    default:
+      return slots_[timer->level_][timer->slot_];
+  }
+}
+
+void TimerWheel::Place(Timer* timer) {
+  if (timer->expiry_ <= now_) {
+    timer->level_ = kDueLevel;
+    due_.PushBack(timer);
+    return;
+  }
+  // The level is the one of the most significant digit in which the expiry
+  // differs from the current tick.
+  int level = (std::bit_width(timer->expiry_ ^ now_) - 1) / kLevelBits;
+  int slot = (timer->expiry_ >> Shift(level)) & kSlotMask;
+  timer->level_ = level;
+  timer->slot_ = slot;
+  slots_[level][slot].PushBack(timer);
+  occupied_[level] |= uint64_t(1) << slot;
+}
+
+void TimerWheel::Cascade(int level, int slot) {
+  occupied_[level] &= ~(uint64_t(1) << slot);
+  IntrusiveList<Timer> timers;
+  timers.Splice(slots_[level][slot]);
+  while (Timer* timer = timers.PopFront()) {
+    Place(timer);
+  }
+}
+
+void TimerWheel::Expire(IntrusiveList<Timer>& list) {
+  // Expired timers are moved to `firing_` first, so that the callbacks can
+  // remove the ones which didn't fire yet. Timers added by the callbacks are
+  // not expired by this call.
+  while (Timer* timer = list.PopFront()) {
+    timer->level_ = kFiringLevel;
+    firing_.PushBack(timer);
+  }
+  while (Timer* timer = firing_.PopFront()) {
+    size_--;
+    timer->OnExpired();
+  }
+}
+
+}  // namespace coro::util
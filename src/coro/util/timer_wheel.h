@@ -0,0 +1,79 @@
+#ifndef CORO_UTIL_TIMER_WHEEL_H
+#define CORO_UTIL_TIMER_WHEEL_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include "coro/util/intrusive_list.h"
+
+namespace coro::util {
+
+// Hierarchical timer wheel. Time is measured in abstract ticks; each of the
+// levels has 64 slots, a slot at level L spanning 64^L ticks. Adding and
+// removing a timer is O(1) and never allocates, a timer is moved to a finer
+// level at most once per level before it expires.
+class TimerWheel {
+ public:
+  class Timer : public IntrusiveListNode<Timer> {
+   public:
+    virtual ~Timer() = default;
+
+    uint64_t expiry() const { return expiry_; }
+
+   protected:
+    // Called with the timer already removed from the wheel.
+    virtual void OnExpired() = 0;
+
+   private:
+    friend class TimerWheel;
+
+    uint64_t expiry_ = 0;
+    int level_ = -1;
+    int slot_ = 0;
+  };
+
+  static constexpr int kLevelBits = 6;
+  static constexpr int kSlotCount = 1 << kLevelBits;
+  static constexpr int kLevelCount = 8;
+
+  explicit TimerWheel(uint64_t now = 0) : now_(now) {}
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  // Timers due at or before the current tick expire on the next Advance.
+  void Add(Timer* timer, uint64_t expiry);
+  void Remove(Timer* timer);
+
+  // Expires all the timers due at or before `now`, in expiry order.
+  void Advance(uint64_t now);
+
+  // Earliest tick at which Advance has work to do: either a timer expires or
+  // timers get moved to a finer level. std::nullopt if there are no timers.
+  std::optional<uint64_t> NextTick() const;
+
+  uint64_t now() const { return now_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+ private:
+  static constexpr int kDueLevel = -1;
+  static constexpr int kFiringLevel = -2;
+
+  std::optional<uint64_t> NextSlotTick() const;
+  IntrusiveList<Timer>& List(const Timer* timer);
+  void Place(Timer* timer);
+  void Cascade(int level, int slot);
+  void Expire(IntrusiveList<Timer>& list);
+
+  uint64_t now_;
+  size_t size_ = 0;
+  std::array<std::array<IntrusiveList<Timer>, kSlotCount>, kLevelCount> slots_;
+  std::array<uint64_t, kLevelCount> occupied_ = {};
+  IntrusiveList<Timer> due_;
+  IntrusiveList<Timer> firing_;
+};
+
+}  // namespace coro::util
+
+#endif  // CORO_UTIL_TIMER_WHEEL_H
@@ -5,7 +5,10 @@
 #include <vector>
 
 #include "coro/promise.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/stdx/stop_source.h"
 #include "coro/task.h"
+#include "coro/when_any.h"
 
 namespace coro {
 
@@ -47,6 +50,63 @@ struct WhenAll<std::index_sequence<Index...>> {
   }
 };
 
+template <typename>
+struct WhenAllFailFast;
+
+template <size_t... Index>
+struct WhenAllFailFast<std::index_sequence<Index...>> {
+  template <typename... F>
+  struct State {
+    explicit State(const stdx::stop_token& stop_token)
+        : stop_source(stop_token.deadline()) {}
+
+    stdx::stop_source stop_source;
+    std::tuple<std::optional<VoidToMonostateT<WhenAnyResultT<F>>>...> result;
+    std::exception_ptr exception;
+    Promise<void> semaphore;
+    size_t pending = sizeof...(F);
+  };
+
+  template <size_t I, typename StateT, typename F>
+  static Task<> RunChild(StateT* state, F func) {
+    try {
+      if constexpr (std::is_void_v<WhenAnyResultT<F>>) {
+        co_await func(state->stop_source.get_token());
+        std::get<I>(state->result).emplace();
+      } else {
+        std::get<I>(state->result)
+            .emplace(co_await func(state->stop_source.get_token()));
+      }
+    } catch (...) {
+      if (!state->exception) {
+        state->exception = std::current_exception();
+        state->stop_source.request_stop();
+      }
+    }
+    if (--state->pending == 0) {
+      state->semaphore.SetValue();
+    }
+  }
+
+  template <typename... F>
+  auto operator()(stdx::stop_token stop_token, F... func)
+      -> Task<std::tuple<VoidToMonostateT<WhenAnyResultT<F>>...>> {
+    static_assert(sizeof...(F) > 0);
+    State<F...> state(stop_token);
+    stdx::stop_callback stop_callback(std::move(stop_token), [&] {
+      state.stop_source.request_stop();
+    });
+    (RunTask(RunChild<Index, State<F...>, F>(&state, std::move(func))), ...);
+    co_await state.semaphore;
+    if (state.exception) {
+      std::rethrow_exception(state.exception);
+    }
+    co_return std::apply(
+        [](auto&&... args) { return std::make_tuple(std::move(*args)...); },
+        std::move(state.result));
+  }
+};
+
 }  // namespace internal
 
 template <typename... T>
@@ -55,6 +115,16 @@ auto WhenAll(T... tasks) {
       std::move(tasks)...);
 }
 
+// Like WhenAll, but every func is invoked with a stop token linked to
+// `stop_token`, carrying its deadline, which gets stopped as soon as any of
+// them throws. Once the remaining ones finished, the first exception is
+// rethrown.
+template <typename... F>
+auto WhenAllFailFast(stdx::stop_token stop_token, F... func) {
+  return internal::WhenAllFailFast<std::make_index_sequence<sizeof...(F)>>{}(
+      std::move(stop_token), std::move(func)...);
+}
+
 template <typename Container, typename T = typename Container::value_type::type,
           std::enable_if_t<!std::is_void_v<T>, int> = 0>
 Task<std::vector<T>> WhenAll(Container tasks) {
@@ -0,0 +1,104 @@
+#ifndef CORO_WHEN_ANY_H
+#define CORO_WHEN_ANY_H
+
+#include <exception>
+#include <optional>
+#include <utility>
+#include <variant>
+
+#include "coro/promise.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/task.h"
+
+namespace coro {
+
+namespace internal {
+
+template <typename F>
+using WhenAnyResultT = typename decltype(std::declval<F&>()(
+    std::declval<stdx::stop_token>()))::type;
+
+template <typename T>
+using VoidToMonostateT =
+    std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+template <typename>
+struct WhenAny;
+
+template <size_t... Index>
+struct WhenAny<std::index_sequence<Index...>> {
+  template <typename... F>
+  using ResultT = std::variant<VoidToMonostateT<WhenAnyResultT<F>>...>;
+
+  template <typename... F>
+  struct State {
+    explicit State(const stdx::stop_token& stop_token)
+        : stop_source(stop_token.deadline()) {}
+
+    stdx::stop_source stop_source;
+    std::optional<ResultT<F...>> result;
+    std::exception_ptr exception;
+    Promise<void> semaphore;
+    size_t pending = sizeof...(F);
+  };
+
+  template <size_t I, typename StateT, typename F>
+  static Task<> RunChild(StateT* state, F func) {
+    try {
+      if constexpr (std::is_void_v<WhenAnyResultT<F>>) {
+        co_await func(state->stop_source.get_token());
+        if (!state->result) {
+          state->result.emplace(std::in_place_index<I>);
+          state->stop_source.request_stop();
+        }
+      } else {
+        auto result = co_await func(state->stop_source.get_token());
+        if (!state->result) {
+          state->result.emplace(std::in_place_index<I>, std::move(result));
+          state->stop_source.request_stop();
+        }
+      }
+    } catch (...) {
+      if (!state->exception) {
+        state->exception = std::current_exception();
+      }
+    }
+    if (--state->pending == 0) {
+      state->semaphore.SetValue();
+    }
+  }
+
+  template <typename... F>
+  auto operator()(stdx::stop_token stop_token, F... func)
+      -> Task<ResultT<F...>> {
+    static_assert(sizeof...(F) > 0);
+    State<F...> state(stop_token);
+    stdx::stop_callback stop_callback(std::move(stop_token), [&] {
+      state.stop_source.request_stop();
+    });
+    (RunTask(RunChild<Index, State<F...>, F>(&state, std::move(func))), ...);
+    co_await state.semaphore;
+    if (!state.result) {
+      std::rethrow_exception(state.exception);
+    }
+    co_return std::move(*state.result);
+  }
+};
+
+}  // namespace internal
+
+// Runs func(stop_token) for every func concurrently. Each func receives a stop
+// token linked to `stop_token` and carrying its deadline, which gets stopped
+// as soon as any of them completes successfully. Returns the result of that
+// first one, with the variant's index identifying it, once all the cancelled
+// siblings finished. If none of them succeeds, rethrows the first exception.
+template <typename... F>
+auto WhenAny(stdx::stop_token stop_token, F... func) {
+  return internal::WhenAny<std::make_index_sequence<sizeof...(F)>>{}(
+      std::move(stop_token), std::move(func)...);
+}
+
+}  // namespace coro
+
+#endif  // CORO_WHEN_ANY_H
@@ -0,0 +1,30 @@
+#include "coro/stdx/any_invocable.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+
+namespace coro::stdx {
+namespace {
+
+TEST(AnyInvocableTest, StoresCallableInlineWhenItFits) {
+  std::array<void*, 4> captures{};
+  uint64_t allocation_count = any_invocable_heap_allocation_count();
+  any_invocable<size_t(), 4 * sizeof(void*)> func(
+      [captures] { return captures.size(); });
+  EXPECT_EQ(func(), 4);
+  any_invocable<size_t(), 4 * sizeof(void*)> moved = std::move(func);
+  EXPECT_EQ(moved(), 4);
+  EXPECT_EQ(any_invocable_heap_allocation_count(), allocation_count);
+}
+
+TEST(AnyInvocableTest, AllocatesCallableLargerThanBuffer) {
+  std::array<void*, 4> captures{};
+  uint64_t allocation_count = any_invocable_heap_allocation_count();
+  any_invocable<size_t()> func([captures] { return captures.size(); });
+  EXPECT_EQ(func(), 4);
+  EXPECT_EQ(any_invocable_heap_allocation_count(), allocation_count + 1);
+}
+
+}  // namespace
+}  // namespace coro::stdx
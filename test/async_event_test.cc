@@ -0,0 +1,135 @@
+#include "coro/async_event.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "coro/async_condition_variable.h"
+#include "coro/mutex.h"
+#include "coro/task.h"
+
+namespace coro {
+namespace {
+
+TEST(AsyncEventTest, ManualResetReleasesAllWaitersUntilReset) {
+  AsyncEvent event;
+  int resumed_count = 0;
+  auto wait = [&]() -> Task<> {
+    co_await event.Wait();
+    resumed_count++;
+  };
+  RunTask(wait);
+  RunTask(wait);
+  EXPECT_EQ(event.waiter_count(), 2);
+  event.Set();
+  EXPECT_EQ(resumed_count, 2);
+  RunTask(wait);
+  EXPECT_EQ(resumed_count, 3);
+  event.Reset();
+  RunTask(wait);
+  EXPECT_EQ(resumed_count, 3);
+  event.Set();
+  EXPECT_EQ(resumed_count, 4);
+}
+
+TEST(AsyncEventTest, AutoResetReleasesOneWaiterPerSet) {
+  AsyncEvent event(AsyncEventMode::kAutoReset);
+  stdx::stop_source stop_source;
+  std::string log;
+  auto wait = [&](std::string name) -> Task<> {
+    try {
+      co_await event.Wait(stop_source.get_token());
+      log += name;
+    } catch (const InterruptedException&) {
+      log += "!" + name;
+    }
+  };
+  event.Set();
+  RunTask(wait, "a");
+  EXPECT_FALSE(event.is_set());
+  RunTask(wait, "b");
+  RunTask(wait, "c");
+  event.Set();
+  EXPECT_EQ(log, "ab");
+  stop_source.request_stop();
+  EXPECT_EQ(log, "ab!c");
+  EXPECT_EQ(event.waiter_count(), 0);
+}
+
+TEST(AsyncConditionVariableTest, WaitsForPredicateUnderMutex) {
+  Mutex mutex;
+  AsyncConditionVariable condition_variable;
+  std::vector<int> queue;
+  std::vector<int> received;
+  auto consume = [&]() -> Task<> {
+    auto lock = co_await UniqueLock::Create(&mutex);
+    co_await condition_variable.Wait(lock, [&] { return !queue.empty(); });
+    received.push_back(queue.back());
+    queue.pop_back();
+  };
+  auto produce = [&](int value) -> Task<> {
+    auto lock = co_await UniqueLock::Create(&mutex);
+    queue.push_back(value);
+    condition_variable.NotifyOne();
+  };
+  RunTask(consume);
+  RunTask(consume);
+  EXPECT_EQ(condition_variable.waiter_count(), 2);
+  RunTask(produce, 1);
+  RunTask(produce, 2);
+  EXPECT_EQ(received, (std::vector<int>{1, 2}));
+  EXPECT_EQ(condition_variable.waiter_count(), 0);
+}
+
+TEST(AsyncConditionVariableTest, NotifyAllHandsMutexOverInOrder) {
+  Mutex mutex;
+  AsyncConditionVariable condition_variable;
+  std::string log;
+  auto wait = [&](char name) -> Task<> {
+    auto lock = co_await UniqueLock::Create(&mutex);
+    co_await condition_variable.Wait(lock);
+    log += name;
+  };
+  RunTask(wait, 'a');
+  RunTask(wait, 'b');
+  RunTask(wait, 'c');
+  RunTask([&]() -> Task<> {
+    auto lock = co_await UniqueLock::Create(&mutex);
+    condition_variable.NotifyAll();
+    EXPECT_EQ(condition_variable.waiter_count(), 0);
+    log += '!';
+  });
+  EXPECT_EQ(log, "!abc");
+}
+
+TEST(AsyncConditionVariableTest, InterruptedWaiterReacquiresMutex) {
+  Mutex mutex;
+  AsyncConditionVariable condition_variable;
+  stdx::stop_source stop_source;
+  std::string log;
+  RunTask([&]() -> Task<> {
+    auto lock = co_await UniqueLock::Create(&mutex);
+    try {
+      co_await condition_variable.Wait(lock, stop_source.get_token());
+    } catch (const InterruptedException&) {
+      log += 'i';
+    }
+  });
+  RunTask([&]() -> Task<> {
+    auto lock = co_await UniqueLock::Create(&mutex);
+    stop_source.request_stop();
+    EXPECT_EQ(condition_variable.waiter_count(), 0);
+    log += '!';
+  });
+  EXPECT_EQ(log, "!i");
+  bool locked = false;
+  RunTask([&]() -> Task<> {
+    auto lock = co_await UniqueLock::Create(&mutex);
+    locked = true;
+  });
+  EXPECT_TRUE(locked);
+}
+
+}  // namespace
+}  // namespace coro
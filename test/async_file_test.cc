@@ -0,0 +1,158 @@
+#include "coro/util/async_file.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "coro/exception.h"
+#include "coro/http/http.h"
+
+namespace coro::util {
+namespace {
+
+class AsyncFileTest : public ::testing::Test {
+ protected:
+  AsyncFileTest()
+      : path_((std::filesystem::temp_directory_path() /
+               ("coro-async-file-" +
+                std::string(::testing::UnitTest::GetInstance()
+                                ->current_test_info()
+                                ->name())))
+                  .string()) {}
+
+  ~AsyncFileTest() override { std::filesystem::remove(path_); }
+
+  template <typename F>
+  void Run(F func) {
+    // Jobs in flight on the thread pool keep the event loop running.
+    RunTask(std::move(func));
+    event_loop_.EnterLoop();
+  }
+
+  void WriteFile(const std::string& content) {
+    std::ofstream(path_, std::ofstream::binary) << content;
+  }
+
+  std::string ReadFile() {
+    std::ifstream stream(path_, std::ifstream::binary);
+    return std::string(std::istreambuf_iterator<char>(stream), {});
+  }
+
+  static std::string Pattern(size_t size) {
+    std::string data(size, 0);
+    for (size_t i = 0; i < size; i++) {
+      data[i] = static_cast<char>('a' + i % 26);
+    }
+    return data;
+  }
+
+  EventLoop event_loop_;
+  ThreadPool thread_pool_{&event_loop_, 2};
+  std::string path_;
+};
+
+TEST_F(AsyncFileTest, ReadsAndWrites) {
+  std::string content;
+  std::string tail;
+  int64_t size = 0;
+  Run([&]() -> Task<> {
+    AsyncFile file = co_await AsyncFile::Open(&thread_pool_, path_,
+                                              AsyncFile::Mode::kReadWrite);
+    co_await file.Write(0, "hello world");
+    co_await file.Write(6, "there");
+    co_await file.Fsync();
+    content = co_await file.Read(0, 5);
+    tail = co_await file.Read(6, 100);
+    size = co_await file.GetSize();
+  });
+  EXPECT_EQ(content, "hello");
+  EXPECT_EQ(tail, "there");
+  EXPECT_EQ(size, 11);
+  EXPECT_EQ(ReadFile(), "hello there");
+}
+
+TEST_F(AsyncFileTest, ThrowsWhenFileIsMissing) {
+  bool thrown = false;
+  Run([&]() -> Task<> {
+    try {
+      co_await AsyncFile::Open(&thread_pool_, path_ + "-missing",
+                               AsyncFile::Mode::kRead);
+    } catch (const RuntimeError&) {
+      thrown = true;
+    }
+  });
+  EXPECT_TRUE(thrown);
+}
+
+TEST_F(AsyncFileTest, StreamsWholeFile) {
+  std::string expected = Pattern(1000);
+  WriteFile(expected);
+  std::vector<std::string> chunks;
+  Run([&]() -> Task<> {
+    AsyncFile file =
+        co_await AsyncFile::Open(&thread_pool_, path_, AsyncFile::Mode::kRead);
+    FOR_CO_AWAIT(std::string & chunk,
+                 file.ReadStream({}, {.chunk_size = 300, .readahead = 2})) {
+      chunks.push_back(std::move(chunk));
+    }
+  });
+  ASSERT_EQ(chunks.size(), 4);
+  EXPECT_EQ(chunks[3].size(), 100);
+  std::string content;
+  for (const std::string& chunk : chunks) {
+    content += chunk;
+  }
+  EXPECT_EQ(content, expected);
+}
+
+TEST_F(AsyncFileTest, StreamsRange) {
+  std::string expected = Pattern(1000);
+  WriteFile(expected);
+  std::string content;
+  Run([&]() -> Task<> {
+    AsyncFile file =
+        co_await AsyncFile::Open(&thread_pool_, path_, AsyncFile::Mode::kRead);
+    content = co_await http::GetBody(
+        file.ReadStream({.start = 10, .end = 509}, {.chunk_size = 64}));
+  });
+  EXPECT_EQ(content, expected.substr(10, 500));
+}
+
+TEST_F(AsyncFileTest, StreamOutlivesFile) {
+  std::string expected = Pattern(100000);
+  WriteFile(expected);
+  std::string content;
+  Run([&]() -> Task<> {
+    http::Response<> response;
+    response.status = 200;
+    {
+      AsyncFile file = co_await AsyncFile::Open(&thread_pool_, path_,
+                                                AsyncFile::Mode::kRead);
+      response.body = file.ReadStream();
+    }
+    content = co_await http::GetBody(std::move(response.body));
+  });
+  EXPECT_EQ(content, expected);
+}
+
+TEST_F(AsyncFileTest, StopsStreamEarly) {
+  WriteFile(Pattern(100000));
+  std::string first;
+  Run([&]() -> Task<> {
+    AsyncFile file =
+        co_await AsyncFile::Open(&thread_pool_, path_, AsyncFile::Mode::kRead);
+    {
+      Generator<std::string> stream =
+          file.ReadStream({}, {.chunk_size = 100, .readahead = 8});
+      auto it = co_await stream.begin();
+      first = std::move(*it);
+    }
+  });
+  EXPECT_EQ(first, Pattern(100));
+}
+
+}  // namespace
+}  // namespace coro::util
@@ -0,0 +1,60 @@
+#include "coro/async_scope.h"
+
+#include <gtest/gtest.h>
+
+#include "coro/util/event_loop.h"
+
+namespace coro {
+namespace {
+
+using ::coro::util::EventLoop;
+
+TEST(AsyncScopeTest, JoinWaitsForSpawnedCoroutines) {
+  EventLoop event_loop;
+  AsyncScope scope;
+  int finished_count = 0;
+  bool joined = false;
+  auto wait = [&](int msec) -> Task<> {
+    co_await event_loop.Wait(msec, scope.get_token());
+    finished_count++;
+  };
+  scope.Spawn(wait, 1);
+  scope.Spawn(wait, 2);
+  EXPECT_EQ(scope.active_count(), 2);
+  RunTask([&]() -> Task<> {
+    co_await scope.Join();
+    joined = true;
+  });
+  event_loop.EnterLoop();
+  EXPECT_TRUE(joined);
+  EXPECT_EQ(finished_count, 2);
+  EXPECT_EQ(scope.active_count(), 0);
+  EXPECT_EQ(scope.spawned_count(), 2);
+}
+
+TEST(AsyncScopeTest, RequestStopCancelsSpawnedCoroutines) {
+  EventLoop event_loop;
+  AsyncScope scope;
+  int finished_count = 0;
+  auto wait = [&]() -> Task<> {
+    co_await event_loop.Wait(10000, scope.get_token());
+    finished_count++;
+  };
+  for (int i = 0; i < 3; i++) {
+    scope.Spawn(wait);
+  }
+  bool joined = false;
+  RunTask([&]() -> Task<> {
+    co_await event_loop.Wait(1);
+    scope.RequestStop();
+    co_await scope.Join();
+    joined = true;
+  });
+  event_loop.EnterLoop();
+  EXPECT_TRUE(joined);
+  EXPECT_EQ(finished_count, 0);
+  EXPECT_EQ(scope.active_count(), 0);
+}
+
+}  // namespace
+}  // namespace coro
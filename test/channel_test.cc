@@ -0,0 +1,129 @@
+#include "coro/channel.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "coro/util/event_loop.h"
+
+namespace coro {
+namespace {
+
+using ::coro::util::EventLoop;
+using ::coro::util::EventLoopType;
+
+TEST(ChannelTest, DeliversValuesInOrderWithBoundedBuffer) {
+  EventLoop event_loop;
+  Channel<int> channel(2);
+  std::vector<int> received;
+  size_t max_size = 0;
+  RunTask([&]() -> Task<> {
+    for (int i = 0; i < 10; i++) {
+      co_await channel.Send(i);
+      max_size = std::max(max_size, channel.size());
+    }
+    channel.Close();
+  });
+  RunTask([&]() -> Task<> {
+    while (auto value = co_await channel.Receive()) {
+      received.push_back(*value);
+      co_await event_loop.Wait(1);
+    }
+  });
+  event_loop.EnterLoop();
+  EXPECT_EQ(received, (std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+  EXPECT_EQ(max_size, 2);
+}
+
+TEST(ChannelTest, CloseAndCancellationWakeSenders) {
+  EventLoop event_loop;
+  Channel<std::string> channel(0);
+  stdx::stop_source stop_source;
+  std::string log;
+  RunTask([&]() -> Task<> {
+    co_await channel.Send("a");
+    log += "sent ";
+    try {
+      co_await channel.Send("b", stop_source.get_token());
+    } catch (const InterruptedException&) {
+      log += "interrupted ";
+    }
+    try {
+      co_await channel.Send("c");
+    } catch (const ChannelClosedException&) {
+      log += "closed ";
+    }
+  });
+  RunTask([&]() -> Task<> {
+    auto value = co_await channel.Receive();
+    log += *value + " ";
+    stop_source.request_stop();
+    co_await event_loop.Wait(1);
+    channel.Close();
+    if (!co_await channel.Receive()) {
+      log += "eof";
+    }
+  });
+  event_loop.EnterLoop();
+  // Handing the value over resumes the sender before Receive returns.
+  EXPECT_EQ(log, "sent a interrupted closed eof");
+}
+
+TEST(ChannelTest, WakesOnEventLoopThreadThroughReadyQueue) {
+  EventLoop event_loop;
+  Channel<int> channel(&event_loop, 0);
+  std::vector<std::string> order;
+  RunTask([&]() -> Task<> {
+    co_await channel.Receive();
+    order.push_back("receiver");
+  });
+  auto schedule = [&](std::string name) {
+    RunTask([&, name]() -> Task<> {
+      co_await event_loop.Schedule();
+      order.push_back(name);
+    });
+  };
+  schedule("before");
+  // Queues the receiver up between the scheduled coroutines.
+  RunTask(channel.Send(1));
+  schedule("after");
+  event_loop.EnterLoop();
+  EXPECT_EQ(order,
+            (std::vector<std::string>{"before", "receiver", "after"}));
+}
+
+TEST(ChannelTest, ThreadsFeedEventLoop) {
+  constexpr int kThreadCount = 4;
+  constexpr int kValueCount = 1000;
+  EventLoop event_loop;
+  Channel<int> channel(&event_loop, 8);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreadCount; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < kValueCount; j++) {
+        channel.BlockingSend(1);
+      }
+    });
+  }
+  std::thread closer([&] {
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    channel.Close();
+  });
+  int sum = 0;
+  RunTask([&]() -> Task<> {
+    while (auto value = co_await channel.Receive()) {
+      sum += *value;
+    }
+    event_loop.ExitLoop();
+  });
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  closer.join();
+  EXPECT_EQ(sum, kThreadCount * kValueCount);
+}
+
+}  // namespace
+}  // namespace coro
@@ -0,0 +1,217 @@
+#include "coro/concurrent_map.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "coro/util/event_loop.h"
+
+namespace coro {
+namespace {
+
+using ::coro::util::EventLoop;
+
+template <typename F>
+void RunLoop(EventLoop& event_loop, F func) {
+  std::exception_ptr exception;
+  RunTask([&]() -> Task<> {
+    try {
+      co_await func();
+    } catch (...) {
+      exception = std::current_exception();
+    }
+  });
+  event_loop.EnterLoop();
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+TEST(ConcurrentMapTest, RespectsMaxInFlight) {
+  EventLoop event_loop;
+  int running = 0;
+  int max_running = 0;
+  std::vector<int> results;
+  RunLoop(event_loop, [&]() -> Task<> {
+    auto generator = ConcurrentMap(
+        std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9},
+        [&](int item, stdx::stop_token stop_token) -> Task<int> {
+          running++;
+          max_running = std::max(max_running, running);
+          co_await event_loop.Wait(5, std::move(stop_token));
+          running--;
+          co_return item * 2;
+        },
+        /*max_in_flight=*/3);
+    FOR_CO_AWAIT(int result, generator) { results.push_back(result); }
+  });
+  EXPECT_EQ(max_running, 3);
+  EXPECT_EQ(results, (std::vector<int>{0, 2, 4, 6, 8, 10, 12, 14, 16, 18}));
+}
+
+TEST(ConcurrentMapTest, YieldsInInputOrder) {
+  EventLoop event_loop;
+  std::vector<int> results;
+  RunLoop(event_loop, [&]() -> Task<> {
+    auto generator = ConcurrentMap(
+        std::vector<int>{0, 1, 2, 3, 4},
+        [&](int item, stdx::stop_token stop_token) -> Task<int> {
+          co_await event_loop.Wait((5 - item) * 10, std::move(stop_token));
+          co_return item;
+        },
+        /*max_in_flight=*/5, ConcurrentMapOrder::kInput);
+    FOR_CO_AWAIT(int result, generator) { results.push_back(result); }
+  });
+  EXPECT_EQ(results, (std::vector<int>{0, 1, 2, 3, 4}));
+}
+
+TEST(ConcurrentMapTest, YieldsInCompletionOrder) {
+  EventLoop event_loop;
+  std::vector<int> results;
+  RunLoop(event_loop, [&]() -> Task<> {
+    auto generator = ConcurrentMap(
+        std::vector<int>{0, 1, 2, 3, 4},
+        [&](int item, stdx::stop_token stop_token) -> Task<int> {
+          co_await event_loop.Wait((5 - item) * 10, std::move(stop_token));
+          co_return item;
+        },
+        /*max_in_flight=*/5, ConcurrentMapOrder::kCompletion);
+    FOR_CO_AWAIT(int result, generator) { results.push_back(result); }
+  });
+  EXPECT_EQ(results, (std::vector<int>{4, 3, 2, 1, 0}));
+}
+
+TEST(ConcurrentMapTest, BoundsReorderWindow) {
+  EventLoop event_loop;
+  int started = 0;
+  int yielded = 0;
+  int max_window = 0;
+  RunLoop(event_loop, [&]() -> Task<> {
+    auto generator = ConcurrentMap(
+        std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7},
+        [&](int item, stdx::stop_token stop_token) -> Task<int> {
+          started++;
+          max_window = std::max(max_window, started - yielded);
+          co_await event_loop.Wait(item == 0 ? 50 : 1, std::move(stop_token));
+          co_return item;
+        },
+        /*max_in_flight=*/3, ConcurrentMapOrder::kInput);
+    FOR_CO_AWAIT(int result, generator) {
+      EXPECT_EQ(result, yielded);
+      yielded++;
+    }
+  });
+  EXPECT_EQ(started, 8);
+  EXPECT_EQ(yielded, 8);
+  EXPECT_EQ(max_window, 3);
+}
+
+TEST(ConcurrentMapTest, PropagatesExceptionAndStopsOthers) {
+  EventLoop event_loop;
+  int interrupted = 0;
+  EXPECT_THROW(
+      RunLoop(event_loop,
+              [&]() -> Task<> {
+                auto generator = ConcurrentMap(
+                    std::vector<int>{0, 1, 2, 3},
+                    [&](int item, stdx::stop_token stop_token) -> Task<int> {
+                      if (item == 2) {
+                        co_await event_loop.Wait(5, std::move(stop_token));
+                        throw RuntimeError("failed");
+                      }
+                      try {
+                        co_await event_loop.Wait(10000, std::move(stop_token));
+                      } catch (const InterruptedException&) {
+                        interrupted++;
+                        throw;
+                      }
+                      co_return item;
+                    },
+                    /*max_in_flight=*/4);
+                FOR_CO_AWAIT(int result, generator) { (void)result; }
+              }),
+      RuntimeError);
+  EXPECT_EQ(interrupted, 3);
+}
+
+TEST(ConcurrentMapTest, StopsItemsWhenAbandoned) {
+  EventLoop event_loop;
+  int interrupted = 0;
+  std::optional<int> first;
+  RunLoop(event_loop, [&]() -> Task<> {
+    {
+      auto generator = ConcurrentMap(
+          std::vector<int>{0, 1, 2, 3},
+          [&](int item, stdx::stop_token stop_token) -> Task<int> {
+            try {
+              co_await event_loop.Wait(item == 0 ? 1 : 10000,
+                                       std::move(stop_token));
+            } catch (const InterruptedException&) {
+              interrupted++;
+              throw;
+            }
+            co_return item;
+          },
+          /*max_in_flight=*/4);
+      auto it = co_await generator.begin();
+      first = *it;
+    }
+  });
+  EXPECT_EQ(first, 0);
+  EXPECT_EQ(interrupted, 3);
+}
+
+TEST(ConcurrentMapTest, RejectsZeroMaxInFlight) {
+  EventLoop event_loop;
+  EXPECT_THROW(RunLoop(event_loop,
+                       [&]() -> Task<> {
+                         auto generator = ConcurrentMap(
+                             std::vector<int>{0},
+                             [](int item) -> Task<int> { co_return item; },
+                             /*max_in_flight=*/0);
+                         co_await generator.begin();
+                       }),
+               InvalidArgument);
+}
+
+TEST(ConcurrentForEachTest, RunsEveryItem) {
+  EventLoop event_loop;
+  int running = 0;
+  int max_running = 0;
+  std::vector<int> visited;
+  RunLoop(event_loop, [&]() -> Task<> {
+    auto visit = [&](int item, stdx::stop_token stop_token) -> Task<> {
+      running++;
+      max_running = std::max(max_running, running);
+      co_await event_loop.Wait(5, std::move(stop_token));
+      running--;
+      visited.push_back(item);
+    };
+    std::vector<int> items = {0, 1, 2, 3, 4, 5};
+    co_await ConcurrentForEach(std::move(items), std::move(visit),
+                               /*max_in_flight=*/2);
+  });
+  std::sort(visited.begin(), visited.end());
+  EXPECT_EQ(visited, (std::vector<int>{0, 1, 2, 3, 4, 5}));
+  EXPECT_EQ(max_running, 2);
+}
+
+TEST(ConcurrentForEachTest, PropagatesException) {
+  EventLoop event_loop;
+  auto for_each = [&]() -> Task<> {
+    auto visit = [](int item) -> Task<> {
+      if (item == 1) {
+        throw RuntimeError("failed");
+      }
+      co_return;
+    };
+    std::vector<int> items = {0, 1, 2};
+    co_await ConcurrentForEach(std::move(items), std::move(visit),
+                               /*max_in_flight=*/2);
+  };
+  EXPECT_THROW(RunLoop(event_loop, for_each), RuntimeError);
+}
+
+}  // namespace
+}  // namespace coro
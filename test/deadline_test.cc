@@ -0,0 +1,132 @@
+#include "coro/deadline.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <vector>
+
+#include "coro/async_scope.h"
+#include "coro/concurrent_map.h"
+#include "coro/util/event_loop.h"
+#include "coro/when_all.h"
+#include "coro/when_any.h"
+
+namespace coro {
+namespace {
+
+using ::coro::util::EventLoop;
+using ::std::chrono::milliseconds;
+
+TEST(DeadlineTest, ThrowsTimeoutWhenTaskOverruns) {
+  EventLoop event_loop;
+  bool timed_out = false;
+  RunTask([&]() -> Task<> {
+    try {
+      co_await WithTimeout(
+          event_loop,
+          [&](stdx::stop_token stop_token) -> Task<> {
+            co_await event_loop.Wait(10000, std::move(stop_token));
+          },
+          milliseconds(5));
+    } catch (const TimeoutException&) {
+      timed_out = true;
+    }
+  });
+  event_loop.EnterLoop();
+  EXPECT_TRUE(timed_out);
+}
+
+TEST(DeadlineTest, ReturnsResultWithinDeadline) {
+  EventLoop event_loop;
+  int result = 0;
+  RunTask([&]() -> Task<> {
+    result = co_await WithTimeout(
+        event_loop,
+        [&](stdx::stop_token stop_token) -> Task<int> {
+          co_await event_loop.Wait(1, std::move(stop_token));
+          co_return 42;
+        },
+        milliseconds(10000));
+  });
+  event_loop.EnterLoop();
+  EXPECT_EQ(result, 42);
+}
+
+TEST(DeadlineTest, NestedCallsInheritEarlierDeadline) {
+  EventLoop event_loop;
+  milliseconds outer_remaining{}, inner_remaining{};
+  bool timed_out = false;
+  RunTask([&]() -> Task<> {
+    try {
+      co_await WithTimeout(
+          event_loop,
+          [&](stdx::stop_token stop_token) -> Task<> {
+            outer_remaining = GetRemainingTime(stop_token);
+            co_await WithTimeout(
+                event_loop,
+                [&](stdx::stop_token stop_token) -> Task<> {
+                  inner_remaining = GetRemainingTime(stop_token);
+                  co_await event_loop.Wait(10000, std::move(stop_token));
+                },
+                milliseconds(60000), std::move(stop_token));
+          },
+          milliseconds(20));
+    } catch (const TimeoutException&) {
+      timed_out = true;
+    }
+  });
+  event_loop.EnterLoop();
+  EXPECT_TRUE(timed_out);
+  EXPECT_LE(outer_remaining, milliseconds(20));
+  EXPECT_LE(inner_remaining, outer_remaining);
+  EXPECT_EQ(GetRemainingTime(stdx::stop_token()), milliseconds::max());
+}
+
+TEST(DeadlineTest, CombinatorsPassDeadlineOn) {
+  EventLoop event_loop;
+  Deadline deadline;
+  Deadline when_any_deadline;
+  Deadline when_all_deadline;
+  Deadline for_each_deadline;
+  Deadline scope_deadline;
+  RunTask([&]() -> Task<> {
+    co_await WithTimeout(
+        event_loop,
+        [&](stdx::stop_token stop_token) -> Task<> {
+          deadline = GetDeadline(stop_token);
+          co_await WhenAny(
+              stop_token,
+              [&](stdx::stop_token stop_token) -> Task<> {
+                when_any_deadline = GetDeadline(stop_token);
+                co_return;
+              },
+              [&](stdx::stop_token stop_token) -> Task<> {
+                co_await event_loop.Wait(10000, std::move(stop_token));
+              });
+          auto record = [&](stdx::stop_token stop_token) -> Task<> {
+            when_all_deadline = GetDeadline(stop_token);
+            co_return;
+          };
+          co_await WhenAllFailFast(stop_token, std::move(record));
+          auto visit = [&](int, stdx::stop_token stop_token) -> Task<> {
+            for_each_deadline = GetDeadline(stop_token);
+            co_return;
+          };
+          std::vector<int> items = {0};
+          co_await ConcurrentForEach(std::move(items), std::move(visit),
+                                     /*max_in_flight=*/1, stop_token);
+          AsyncScope scope(stop_token);
+          scope_deadline = GetDeadline(scope.get_token());
+        },
+        milliseconds(10000));
+  });
+  event_loop.EnterLoop();
+  EXPECT_NE(deadline, Deadline::max());
+  EXPECT_EQ(when_any_deadline, deadline);
+  EXPECT_EQ(when_all_deadline, deadline);
+  EXPECT_EQ(for_each_deadline, deadline);
+  EXPECT_EQ(scope_deadline, deadline);
+}
+
+}  // namespace
+}  // namespace coro
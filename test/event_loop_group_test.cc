@@ -0,0 +1,145 @@
+#include "coro/util/event_loop_group.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "coro/http/curl_http.h"
+#include "coro/http/http_server.h"
+#include "coro/util/tcp_server.h"
+
+namespace coro::util {
+namespace {
+
+using ::coro::http::CurlHttp;
+using ::coro::http::Request;
+using ::coro::http::Response;
+
+Task<Response<>> Fetch(const CurlHttp& http, std::string url) {
+  return http.Fetch(Request<>{.url = std::move(url)}, stdx::stop_token());
+}
+
+TEST(EventLoopGroupTest, RunsEachEventLoopOnItsOwnThread) {
+  EventLoopGroup group(3);
+  std::set<std::thread::id> threads;
+  for (size_t i = 0; i < group.size(); i++) {
+    threads.insert(group.event_loop(i)->Do([] {
+      return std::this_thread::get_id();
+    }));
+  }
+  EXPECT_EQ(threads.size(), 3);
+  EXPECT_FALSE(threads.contains(std::this_thread::get_id()));
+  EXPECT_EQ(group.Next(), group.event_loop(0));
+  EXPECT_EQ(group.Next(), group.event_loop(1));
+}
+
+TEST(EventLoopGroupTest, MovesCoroutinesBetweenEventLoops) {
+  EventLoop event_loop;
+  EventLoopGroup group(2);
+  std::vector<std::thread::id> group_threads;
+  for (const EventLoop* group_event_loop : group.event_loops()) {
+    group_threads.push_back(
+        group_event_loop->Do([] { return std::this_thread::get_id(); }));
+  }
+  std::vector<std::thread::id> threads;
+  RunTask([&]() -> Task<> {
+    for (size_t i = 0; i < 3; i++) {
+      co_await group.event_loop(i % 2)->Schedule();
+      threads.push_back(std::this_thread::get_id());
+    }
+    co_await event_loop.Schedule();
+    threads.push_back(std::this_thread::get_id());
+    event_loop.ExitLoop();
+  });
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  EXPECT_EQ(threads,
+            (std::vector<std::thread::id>{group_threads[0], group_threads[1],
+                                          group_threads[0],
+                                          std::this_thread::get_id()}));
+}
+
+TEST(EventLoopGroupTest, MovesManyCoroutinesConcurrently) {
+  constexpr int kCoroutineCount = 100;
+  constexpr int kHopCount = 100;
+  EventLoop event_loop;
+  EventLoopGroup group(4);
+  std::atomic<int> hop_count = 0;
+  int done_count = 0;
+  for (int i = 0; i < kCoroutineCount; i++) {
+    RunTask([&, i]() -> Task<> {
+      for (int j = 0; j < kHopCount; j++) {
+        co_await group.event_loop((i + j) % group.size())->Schedule();
+        hop_count++;
+      }
+      co_await event_loop.Schedule();
+      if (++done_count == kCoroutineCount) {
+        event_loop.ExitLoop();
+      }
+    });
+  }
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  EXPECT_EQ(hop_count, kCoroutineCount * kHopCount);
+}
+
+class TcpServerDistributionTest
+    : public ::testing::TestWithParam<TcpServer::Distribution> {};
+
+TEST_P(TcpServerDistributionTest, ServesConnectionsOnGroupThreads) {
+  EventLoop event_loop;
+  EventLoopGroup group(2);
+  std::set<std::thread::id> group_threads;
+  for (const EventLoop* group_event_loop : group.event_loops()) {
+    group_threads.insert(
+        group_event_loop->Do([] { return std::this_thread::get_id(); }));
+  }
+  std::mutex mutex;
+  std::set<std::thread::id> handler_threads;
+  std::vector<std::string> bodies;
+  auto handler = [&](Request<>, stdx::stop_token) -> Task<Response<>> {
+    {
+      std::unique_lock lock(mutex);
+      handler_threads.insert(std::this_thread::get_id());
+    }
+    co_return Response<>{.status = 200, .body = http::CreateBody("response")};
+  };
+  TcpServer::Config config{
+      .address = "127.0.0.1", .port = 0, .distribution = GetParam()};
+  // Separate clients, so that every request gets its own connection.
+  std::vector<CurlHttp> clients;
+  for (int i = 0; i < 4; i++) {
+    clients.emplace_back(&event_loop);
+  }
+  RunTask([&]() -> Task<> {
+    auto http_server =
+        http::CreateHttpServer(handler, &event_loop, &group, config);
+    std::string address =
+        "http://127.0.0.1:" + std::to_string(http_server.GetPort());
+    for (const CurlHttp& http : clients) {
+      auto response = co_await Fetch(http, address);
+      bodies.push_back(co_await http::GetBody(std::move(response.body)));
+    }
+    co_await http_server.Quit();
+    EXPECT_EQ(http_server.connection_count(), 0);
+  });
+  event_loop.EnterLoop();
+  EXPECT_EQ(bodies, std::vector<std::string>(4, "response"));
+  ASSERT_FALSE(handler_threads.empty());
+  for (std::thread::id thread : handler_threads) {
+    EXPECT_TRUE(group_threads.contains(thread));
+  }
+  if (GetParam() == TcpServer::Distribution::kRoundRobin) {
+    EXPECT_EQ(handler_threads, group_threads);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Distributions, TcpServerDistributionTest,
+    ::testing::Values(TcpServer::Distribution::kReusePort,
+                      TcpServer::Distribution::kRoundRobin));
+
+}  // namespace
+}  // namespace coro::util
@@ -0,0 +1,124 @@
+#include "coro/util/event_loop.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "coro/stdx/stop_source.h"
+
+namespace coro::util {
+namespace {
+
+TEST(EventLoopTest, RunsPostedFunctionsInOrder) {
+  EventLoop event_loop;
+  std::vector<int> order;
+  for (int i = 0; i < 5; i++) {
+    event_loop.RunOnEventLoop([&, i] {
+      order.push_back(i);
+      if (i == 2) {
+        // Posted while draining, so it runs after the current batch.
+        event_loop.RunOnEventLoop([&] { order.push_back(5); });
+      }
+    });
+  }
+  event_loop.EnterLoop();
+  EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3, 4, 5}));
+}
+
+TEST(EventLoopTest, RunsFunctionsPostedFromOtherThreads) {
+  constexpr int kThreadCount = 4;
+  constexpr int kPostCount = 10000;
+  EventLoop event_loop;
+  std::thread::id event_loop_thread = std::this_thread::get_id();
+  std::vector<std::vector<int>> received(kThreadCount);
+  int done_count = 0;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreadCount; t++) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kPostCount; i++) {
+        event_loop.RunOnEventLoop([&, t, i] {
+          EXPECT_EQ(std::this_thread::get_id(), event_loop_thread);
+          received[t].push_back(i);
+          if (i == kPostCount - 1 && ++done_count == kThreadCount) {
+            event_loop.ExitLoop();
+          }
+        });
+      }
+    });
+  }
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& values : received) {
+    ASSERT_EQ(values.size(), kPostCount);
+    for (int i = 0; i < kPostCount; i++) {
+      EXPECT_EQ(values[i], i);
+    }
+  }
+}
+
+TEST(EventLoopTest, CancelsWaitsFromOtherThread) {
+  constexpr int kWaitCount = 100;
+  EventLoop event_loop;
+  std::thread::id event_loop_thread = std::this_thread::get_id();
+  stdx::stop_source stop_source;
+  int interrupted = 0;
+  int expired = 0;
+  for (int i = 0; i < kWaitCount; i++) {
+    RunTask([&, i]() -> Task<> {
+      try {
+        // Timers expiring on the event loop while others get cancelled.
+        co_await event_loop.Wait(i % 2 == 0 ? 10000 : i % 10,
+                                 stop_source.get_token());
+        expired++;
+      } catch (const InterruptedException&) {
+        EXPECT_EQ(std::this_thread::get_id(), event_loop_thread);
+        interrupted++;
+      }
+    });
+  }
+  std::thread thread([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    stop_source.request_stop();
+  });
+  event_loop.EnterLoop();
+  thread.join();
+  EXPECT_EQ(interrupted + expired, kWaitCount);
+  EXPECT_GE(interrupted, kWaitCount / 2);
+}
+
+TEST(EventLoopTest, RunsCoroutinesScheduledWhileDrainingInNextIteration) {
+  EventLoop event_loop;
+  std::vector<std::string> order;
+  RunTask([&]() -> Task<> {
+    co_await event_loop.Schedule();
+    order.push_back("a");
+    event_loop.RunOnEventLoop([&] { order.push_back("posted"); });
+    // Resumed only once the event loop got to its other events.
+    co_await event_loop.Yield();
+    order.push_back("a");
+  });
+  RunTask([&]() -> Task<> {
+    co_await event_loop.Schedule();
+    order.push_back("b");
+  });
+  event_loop.EnterLoop();
+  EXPECT_EQ(order, (std::vector<std::string>{"a", "b", "posted", "a"}));
+}
+
+TEST(EventLoopTest, DropsFunctionsPostedAfterExit) {
+  auto event_loop = std::make_unique<EventLoop>();
+  bool ran = false;
+  event_loop->RunOnEventLoop([&ran, value = std::make_shared<int>(1)] {
+    ran = true;
+  });
+  event_loop.reset();
+  EXPECT_FALSE(ran);
+}
+
+}  // namespace
+}  // namespace coro::util
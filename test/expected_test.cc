@@ -0,0 +1,125 @@
+#include "coro/expected.h"
+
+#include <gtest/gtest.h>
+
+#include "coro/shared_promise.h"
+#include "coro/task.h"
+#include "coro/util/event_loop.h"
+
+namespace coro {
+namespace {
+
+using ::coro::util::EventLoop;
+
+TEST(ExpectedTest, ReportsInterruptedWaitWithoutThrowing) {
+  EventLoop event_loop;
+  stdx::stop_source stop_source;
+  std::optional<Expected<void>> result;
+  RunTask([&]() -> Task<> {
+    result = co_await AsExpected(
+        event_loop.Wait(10000, stop_source.get_token()));
+  });
+  RunTask([&]() -> Task<> {
+    co_await event_loop.Wait(1);
+    stop_source.request_stop();
+  });
+  event_loop.EnterLoop();
+  ASSERT_TRUE(result);
+  EXPECT_FALSE(*result);
+  EXPECT_TRUE(result->error().interrupted());
+  EXPECT_THROW(result->value(), InterruptedException);
+}
+
+TEST(ExpectedTest, PropagatesErrorThroughTasks) {
+  EventLoop event_loop;
+  auto inner = [&](bool fail) -> Task<Expected<int>> {
+    if (fail) {
+      co_return Unexpected::Interrupted();
+    }
+    co_return 42;
+  };
+  auto outer = [&](bool fail) -> Task<Expected<std::string>> {
+    auto result = co_await inner(fail);
+    if (!result) {
+      co_return result.error();
+    }
+    co_return std::to_string(*result);
+  };
+  std::optional<Expected<std::string>> success;
+  std::optional<Expected<std::string>> failure;
+  RunTask([&]() -> Task<> {
+    success = co_await outer(false);
+    failure = co_await outer(true);
+  });
+  event_loop.EnterLoop();
+  ASSERT_TRUE(success && failure);
+  EXPECT_EQ(success->value(), "42");
+  EXPECT_TRUE(failure->error().interrupted());
+}
+
+TEST(ExpectedTest, CatchesExceptionsOfOtherAwaitables) {
+  EventLoop event_loop;
+  std::optional<Expected<int>> result;
+  RunTask([&]() -> Task<> {
+    result = co_await AsExpected([]() -> Task<int> {
+      throw RuntimeError("failed");
+      co_return 0;
+    }());
+  });
+  event_loop.EnterLoop();
+  ASSERT_TRUE(result);
+  EXPECT_FALSE(result->error().interrupted());
+  EXPECT_THROW(result->value(), RuntimeError);
+}
+
+TEST(ExpectedTest, SharedPromiseReportsInterruption) {
+  EventLoop event_loop;
+  stdx::stop_source stop_source;
+  SharedPromise shared_promise([&]() -> Task<int> {
+    co_await event_loop.Wait(10);
+    co_return 42;
+  });
+  std::optional<Expected<std::reference_wrapper<const int>>> interrupted;
+  int value = 0;
+  RunTask([&]() -> Task<> {
+    interrupted = co_await shared_promise.GetExpected(stop_source.get_token());
+  });
+  RunTask([&]() -> Task<> {
+    value = co_await shared_promise.Get(stdx::stop_token());
+  });
+  stop_source.request_stop();
+  event_loop.EnterLoop();
+  ASSERT_TRUE(interrupted);
+  EXPECT_TRUE(interrupted->error().interrupted());
+  EXPECT_EQ(value, 42);
+}
+
+TEST(ExpectedTest, ValueTaskThrowsUnlessAwaitedAsExpected) {
+  EventLoop event_loop;
+  auto produce = [](bool fail) -> Task<Expected<int>> {
+    if (fail) {
+      co_return Unexpected::Interrupted();
+    }
+    co_return 42;
+  };
+  int value = 0;
+  bool thrown = false;
+  std::optional<Expected<int>> interrupted;
+  RunTask([&]() -> Task<> {
+    value = co_await ValueTask<int>(produce(false));
+    try {
+      co_await ValueTask<int>(produce(true));
+    } catch (const InterruptedException&) {
+      thrown = true;
+    }
+    interrupted = co_await AsExpected(ValueTask<int>(produce(true)));
+  });
+  event_loop.EnterLoop();
+  EXPECT_EQ(value, 42);
+  EXPECT_TRUE(thrown);
+  ASSERT_TRUE(interrupted);
+  EXPECT_TRUE(interrupted->error().interrupted());
+}
+
+}  // namespace
+}  // namespace coro
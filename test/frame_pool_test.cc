@@ -0,0 +1,47 @@
+#include "coro/util/frame_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "coro/task.h"
+
+namespace coro::util {
+namespace {
+
+#ifdef CORO_HTTP_FRAME_POOL
+
+Task<int> GetValue(int value) { co_return value; }
+
+TEST(FramePoolTest, RecyclesFramesOfSameSizeClass) {
+  FramePoolStats before = GetFramePoolStats();
+  int sum = 0;
+  RunTask([&]() -> Task<> {
+    sum += co_await GetValue(1);
+    sum += co_await GetValue(2);
+  });
+  FramePoolStats after = GetFramePoolStats();
+  EXPECT_EQ(sum, 3);
+  // The second GetValue frame at least is the first one recycled.
+  EXPECT_GT(after.hit_count, before.hit_count);
+}
+
+TEST(FramePoolTest, BoundsCachedFramesPerSizeClass) {
+  constexpr int kTaskCount = 100;
+  FramePoolStats before = GetFramePoolStats();
+  {
+    // Tasks are lazy, each of them just holds its frame.
+    std::vector<Task<int>> tasks;
+    for (int i = 0; i < kTaskCount; i++) {
+      tasks.push_back(GetValue(i));
+    }
+  }
+  FramePoolStats after = GetFramePoolStats();
+  EXPECT_LE(after.cached_count, before.cached_count + 64);
+  EXPECT_GE(after.miss_count - before.miss_count, kTaskCount - 64);
+}
+
+#endif  // CORO_HTTP_FRAME_POOL
+
+}  // namespace
+}  // namespace coro::util
@@ -0,0 +1,284 @@
+#include "coro/util/io_uring.h"
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "coro/http/curl_http.h"
+#include "coro/http/http_server.h"
+#include "coro/interrupted_exception.h"
+#include "coro/util/async_file.h"
+#include "coro/util/tcp_server.h"
+
+namespace coro::util {
+namespace {
+
+using ::coro::http::CurlHttp;
+using ::coro::http::Request;
+using ::coro::http::Response;
+
+Task<Response<>> Post(const CurlHttp& http, std::string url,
+                      std::string body) {
+  return http.Fetch(Request<>{.url = std::move(url),
+                              .method = http::Method::kPost,
+                              .body = http::CreateBody(std::move(body))},
+                    stdx::stop_token());
+}
+
+std::span<const uint8_t> AsBytes(std::string_view data) {
+  return {reinterpret_cast<const uint8_t*>(data.data()), data.size()};
+}
+
+TEST(IoUringTest, ReadsAndWritesFiles) {
+  EventLoop event_loop;
+  IoUring io_uring(&event_loop);
+  char path[] = "/tmp/coro-io-uring-XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  unlink(path);
+  std::string content;
+  RunTask([&]() -> Task<> {
+    co_await io_uring.Write(fd, AsBytes("hello world"), /*offset=*/0);
+    std::vector<uint8_t> buffer(5);
+    size_t size = co_await io_uring.Read(fd, buffer, /*offset=*/6);
+    content = std::string(buffer.begin(), buffer.begin() + size);
+    co_await io_uring.WaitIdle();
+  });
+  event_loop.EnterLoop();
+  close(fd);
+  EXPECT_EQ(content, "world");
+}
+
+TEST(IoUringTest, BacksAsyncFile) {
+  EventLoop event_loop;
+  IoUring io_uring(&event_loop);
+  ThreadPool thread_pool(&event_loop, 1);
+  char path[] = "/tmp/coro-io-uring-XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  std::string expected;
+  for (int i = 0; i < 10000; i++) {
+    expected += std::to_string(i);
+  }
+  std::string content;
+  RunTask([&]() -> Task<> {
+    AsyncFile file = co_await AsyncFile::Open(&thread_pool, &io_uring, path,
+                                              AsyncFile::Mode::kReadWrite);
+    co_await file.Write(0, expected);
+    content = co_await http::GetBody(
+        file.ReadStream(AsyncFile::Range(), {.chunk_size = 4096}));
+    co_await io_uring.WaitIdle();
+  });
+  event_loop.EnterLoop();
+  unlink(path);
+  EXPECT_EQ(content, expected);
+}
+
+TEST(IoUringTest, SendsAndReceivesOverSockets) {
+  EventLoop event_loop;
+  IoUring io_uring(&event_loop, {.buffer_count = 4, .buffer_size = 4096});
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  // Big enough to go through the zero copy path.
+  std::string sent(64 * 1024, 'x');
+  std::string received;
+  RunTask([&]() -> Task<> {
+    std::span<const uint8_t> remaining = AsBytes(sent);
+    while (!remaining.empty()) {
+      remaining = remaining.subspan(co_await io_uring.Send(fds[0], remaining));
+    }
+    close(fds[0]);
+  });
+  RunTask([&]() -> Task<> {
+    while (true) {
+      std::vector<uint8_t> chunk = co_await io_uring.Recv(fds[1]);
+      if (chunk.empty()) {
+        break;
+      }
+      EXPECT_LE(chunk.size(), 4096);
+      received.append(chunk.begin(), chunk.end());
+    }
+    co_await io_uring.WaitIdle();
+  });
+  event_loop.EnterLoop();
+  close(fds[1]);
+  EXPECT_EQ(received, sent);
+}
+
+TEST(IoUringTest, CancelsPendingOperation) {
+  EventLoop event_loop;
+  IoUring io_uring(&event_loop);
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  stdx::stop_source stop_source;
+  bool interrupted = false;
+  RunTask([&]() -> Task<> {
+    try {
+      co_await io_uring.Recv(fds[1], stop_source.get_token());
+    } catch (const InterruptedException&) {
+      interrupted = true;
+    }
+    co_await io_uring.WaitIdle();
+  });
+  RunTask([&]() -> Task<> {
+    co_await event_loop.Wait(10);
+    stop_source.request_stop();
+  });
+  event_loop.EnterLoop();
+  close(fds[0]);
+  close(fds[1]);
+  EXPECT_TRUE(interrupted);
+  EXPECT_EQ(io_uring.pending_count(), 0);
+}
+
+TEST(IoUringTest, CancelsOperationsFromOtherThread) {
+  constexpr int kOperationCount = 32;
+  EventLoop event_loop;
+  // Too small to fit all the cancellations at once.
+  IoUring io_uring(&event_loop, {.entries = 16, .buffer_count = 0});
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  stdx::stop_source stop_source;
+  int interrupted = 0;
+  for (int i = 0; i < kOperationCount; i++) {
+    RunTask([&]() -> Task<> {
+      try {
+        co_await io_uring.Recv(fds[1], stop_source.get_token());
+      } catch (const InterruptedException&) {
+        interrupted++;
+      }
+    });
+  }
+  std::thread thread([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    stop_source.request_stop();
+  });
+  event_loop.EnterLoop();
+  thread.join();
+  close(fds[0]);
+  close(fds[1]);
+  EXPECT_EQ(interrupted, kOperationCount);
+  EXPECT_EQ(io_uring.pending_count(), 0);
+}
+
+TEST(IoUringTest, AcceptsConnections) {
+  constexpr int kClientCount = 3;
+  EventLoop event_loop;
+  IoUring io_uring(&event_loop);
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(listener, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)),
+            0);
+  ASSERT_EQ(listen(listener, kClientCount), 0);
+  socklen_t length = sizeof(addr);
+  ASSERT_EQ(
+      getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &length), 0);
+  std::vector<int> clients;
+  for (int i = 0; i < kClientCount; i++) {
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_EQ(
+        connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+    clients.push_back(client);
+  }
+  int accepted_count = 0;
+  RunTask([&]() -> Task<> {
+    {
+      IoUring::Acceptor acceptor(&io_uring, listener);
+      for (int i = 0; i < kClientCount; i++) {
+        int fd = co_await acceptor.Accept();
+        EXPECT_GE(fd, 0);
+        close(fd);
+        accepted_count++;
+      }
+    }
+    co_await io_uring.WaitIdle();
+  });
+  event_loop.EnterLoop();
+  for (int client : clients) {
+    close(client);
+  }
+  close(listener);
+  EXPECT_EQ(accepted_count, kClientCount);
+}
+
+TEST(IoUringTest, CancelsAcceptFromOtherThread) {
+  EventLoop event_loop;
+  IoUring io_uring(&event_loop);
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(listener, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)),
+            0);
+  ASSERT_EQ(listen(listener, 1), 0);
+  stdx::stop_source stop_source;
+  bool interrupted = false;
+  std::thread::id resumed_on;
+  RunTask([&]() -> Task<> {
+    {
+      IoUring::Acceptor acceptor(&io_uring, listener);
+      try {
+        co_await acceptor.Accept(stop_source.get_token());
+      } catch (const InterruptedException&) {
+        interrupted = true;
+      }
+      resumed_on = std::this_thread::get_id();
+    }
+    co_await io_uring.WaitIdle();
+  });
+  std::thread thread([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    stop_source.request_stop();
+  });
+  event_loop.EnterLoop();
+  thread.join();
+  close(listener);
+  EXPECT_TRUE(interrupted);
+  EXPECT_EQ(resumed_on, std::this_thread::get_id());
+  EXPECT_EQ(io_uring.pending_count(), 0);
+}
+
+TEST(IoUringTest, ServesHttpRequests) {
+  EventLoop event_loop;
+  EventLoopGroup group(2);
+  std::vector<std::string> bodies;
+  auto handler = [&](Request<> request,
+                     stdx::stop_token) -> Task<Response<>> {
+    std::string body = co_await http::GetBody(std::move(*request.body));
+    co_return Response<>{.status = 200,
+                         .body = http::CreateBody(std::move(body))};
+  };
+  TcpServer::Config config{
+      .address = "127.0.0.1", .port = 0, .use_io_uring = true};
+  CurlHttp http(&event_loop);
+  RunTask([&]() -> Task<> {
+    auto http_server =
+        http::CreateHttpServer(handler, &event_loop, &group, config);
+    std::string address =
+        "http://127.0.0.1:" + std::to_string(http_server.GetPort());
+    for (int i = 0; i < 3; i++) {
+      auto response = co_await Post(http, address, std::to_string(i));
+      bodies.push_back(co_await http::GetBody(std::move(response.body)));
+    }
+    co_await http_server.Quit();
+    EXPECT_EQ(http_server.connection_count(), 0);
+  });
+  event_loop.EnterLoop();
+  EXPECT_EQ(bodies, (std::vector<std::string>{"0", "1", "2"}));
+}
+
+}  // namespace
+}  // namespace coro::util
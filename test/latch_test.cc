@@ -0,0 +1,133 @@
+#include "coro/latch.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "coro/interrupted_exception.h"
+#include "coro/stdx/stop_source.h"
+
+namespace coro {
+namespace {
+
+TEST(LatchTest, WakesAllWaitersAtZero) {
+  Latch latch(2);
+  int woken = 0;
+  auto wait = [&]() -> Task<> {
+    co_await latch.Wait();
+    woken++;
+  };
+  RunTask(wait());
+  RunTask(wait());
+  RunTask(wait());
+  latch.CountDown();
+  EXPECT_EQ(woken, 0);
+  EXPECT_FALSE(latch.TryWait());
+  latch.CountDown();
+  EXPECT_EQ(woken, 3);
+  EXPECT_TRUE(latch.TryWait());
+  RunTask(wait());
+  EXPECT_EQ(woken, 4);
+}
+
+TEST(LatchTest, ArriveAndWaitCountsDown) {
+  Latch latch(3);
+  int woken = 0;
+  auto arrive = [&](int64_t count) -> Task<> {
+    co_await latch.ArriveAndWait(count);
+    woken++;
+  };
+  RunTask(arrive(1));
+  EXPECT_EQ(woken, 0);
+  RunTask(arrive(5));
+  EXPECT_EQ(woken, 2);
+  EXPECT_TRUE(latch.TryWait());
+}
+
+TEST(LatchTest, UnlinksCancelledWaiter) {
+  Latch latch(1);
+  stdx::stop_source stop_source;
+  bool interrupted = false;
+  bool woken = false;
+  RunTask([&]() -> Task<> {
+    try {
+      co_await latch.Wait(stop_source.get_token());
+    } catch (const InterruptedException&) {
+      interrupted = true;
+    }
+  });
+  RunTask([&]() -> Task<> {
+    co_await latch.Wait();
+    woken = true;
+  });
+  stop_source.request_stop();
+  EXPECT_TRUE(interrupted);
+  EXPECT_FALSE(woken);
+  latch.CountDown();
+  EXPECT_TRUE(woken);
+}
+
+TEST(BarrierTest, IsReusedAcrossPhases) {
+  Barrier barrier(3);
+  std::vector<uint64_t> phases[3];
+  auto participant = [&](int index) -> Task<> {
+    for (int i = 0; i < 3; i++) {
+      co_await barrier.ArriveAndWait();
+      phases[index].push_back(barrier.phase());
+    }
+  };
+  RunTask(participant(0));
+  RunTask(participant(1));
+  EXPECT_EQ(barrier.phase(), 0);
+  EXPECT_TRUE(phases[0].empty());
+  RunTask(participant(2));
+  EXPECT_EQ(barrier.phase(), 3);
+  for (const auto& seen : phases) {
+    EXPECT_EQ(seen, (std::vector<uint64_t>{1, 2, 3}));
+  }
+}
+
+TEST(BarrierTest, DroppedParticipantIsNotAwaited) {
+  Barrier barrier(3);
+  int passed = 0;
+  auto participant = [&]() -> Task<> {
+    co_await barrier.ArriveAndWait();
+    passed++;
+    co_await barrier.ArriveAndWait();
+    passed++;
+  };
+  RunTask(participant());
+  RunTask(participant());
+  EXPECT_EQ(passed, 0);
+  barrier.ArriveAndDrop();
+  EXPECT_EQ(passed, 4);
+  EXPECT_EQ(barrier.phase(), 2);
+}
+
+TEST(BarrierTest, WithdrawsCancelledArrival) {
+  Barrier barrier(2);
+  stdx::stop_source stop_source;
+  bool interrupted = false;
+  int passed = 0;
+  RunTask([&]() -> Task<> {
+    try {
+      co_await barrier.ArriveAndWait(stop_source.get_token());
+    } catch (const InterruptedException&) {
+      interrupted = true;
+    }
+  });
+  stop_source.request_stop();
+  EXPECT_TRUE(interrupted);
+  auto participant = [&]() -> Task<> {
+    co_await barrier.ArriveAndWait();
+    passed++;
+  };
+  RunTask(participant());
+  EXPECT_EQ(passed, 0);
+  RunTask(participant());
+  EXPECT_EQ(passed, 2);
+  EXPECT_EQ(barrier.phase(), 1);
+}
+
+}  // namespace
+}  // namespace coro
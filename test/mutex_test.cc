@@ -0,0 +1,141 @@
+#include "coro/mutex.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "coro/interrupted_exception.h"
+#include "coro/util/event_loop.h"
+
+namespace coro {
+namespace {
+
+using ::coro::util::EventLoop;
+
+TEST(MutexTest, HandsLockOverInFifoOrder) {
+  Mutex mutex;
+  std::string order;
+  auto lock = [&](char name) -> Task<> {
+    co_await mutex.Lock();
+    order += name;
+  };
+  RunTask(lock('a'));
+  RunTask(lock('b'));
+  RunTask(lock('c'));
+  EXPECT_EQ(order, "a");
+  mutex.Unlock();
+  EXPECT_EQ(order, "ab");
+  mutex.Unlock();
+  EXPECT_EQ(order, "abc");
+  mutex.Unlock();
+  RunTask(lock('d'));
+  EXPECT_EQ(order, "abcd");
+}
+
+TEST(MutexTest, UniqueLockUnlocksOnDestruction) {
+  Mutex mutex;
+  std::string order;
+  auto lock = [&](char name) -> Task<> {
+    auto guard = co_await UniqueLock::Create(&mutex);
+    order += name;
+  };
+  RunTask([&]() -> Task<> {
+    co_await mutex.Lock();
+    RunTask(lock('a'));
+    RunTask(lock('b'));
+    EXPECT_EQ(order, "");
+    mutex.Unlock();
+  });
+  EXPECT_EQ(order, "ab");
+  RunTask(lock('c'));
+  EXPECT_EQ(order, "abc");
+}
+
+struct LockOrderTest {
+  // A reader holds the lock, then a writer, two readers and another writer
+  // queue up in this order.
+  std::string Run(ReadWriteMutexPolicy policy) {
+    EventLoop event_loop;
+    ReadWriteMutex mutex(policy);
+    std::string order;
+    auto reader = [&](int delay) -> Task<> {
+      co_await event_loop.Wait(delay);
+      auto lock = co_await ReadLock::Create(&mutex);
+      order += 'r';
+      co_await event_loop.Wait(10);
+    };
+    auto writer = [&](int delay) -> Task<> {
+      co_await event_loop.Wait(delay);
+      auto lock = co_await WriteLock::Create(&mutex);
+      order += 'W';
+      co_await event_loop.Wait(10);
+    };
+    RunTask(reader(0));
+    RunTask(writer(1));
+    RunTask(reader(2));
+    RunTask(reader(3));
+    RunTask(writer(4));
+    event_loop.EnterLoop();
+    stats = mutex.stats();
+    return order;
+  }
+
+  ReadWriteMutexStats stats;
+};
+
+TEST(ReadWriteMutexTest, ReaderPreferringLetsReadersBypassWriters) {
+  LockOrderTest test;
+  EXPECT_EQ(test.Run(ReadWriteMutexPolicy::kReaderPreferring), "rrrWW");
+  EXPECT_EQ(test.stats.contended_read_lock_count, 0);
+  EXPECT_EQ(test.stats.contended_write_lock_count, 2);
+}
+
+TEST(ReadWriteMutexTest, WriterPreferringRunsQueuedWritersFirst) {
+  LockOrderTest test;
+  EXPECT_EQ(test.Run(ReadWriteMutexPolicy::kWriterPreferring), "rWWrr");
+  EXPECT_EQ(test.stats.reader_batch_count, 1);
+  EXPECT_EQ(test.stats.max_reader_batch_size, 2);
+}
+
+TEST(ReadWriteMutexTest, PhaseFairAlternatesAndAdmitsReadersInBatch) {
+  LockOrderTest test;
+  EXPECT_EQ(test.Run(ReadWriteMutexPolicy::kPhaseFair), "rWrrW");
+  EXPECT_EQ(test.stats.read_lock_count, 3);
+  EXPECT_EQ(test.stats.write_lock_count, 2);
+  EXPECT_EQ(test.stats.reader_batch_count, 1);
+  EXPECT_EQ(test.stats.max_reader_batch_size, 2);
+}
+
+TEST(ReadWriteMutexTest, CancelledWriterUnblocksReaders) {
+  EventLoop event_loop;
+  ReadWriteMutex mutex;
+  stdx::stop_source stop_source;
+  bool interrupted = false;
+  bool read_locked = false;
+  RunTask([&]() -> Task<> {
+    co_await mutex.ReadLock();
+    co_await event_loop.Wait(10);
+    stop_source.request_stop();
+    mutex.ReadUnlock();
+  });
+  RunTask([&]() -> Task<> {
+    try {
+      co_await mutex.WriteLock(stop_source.get_token());
+    } catch (const InterruptedException&) {
+      interrupted = true;
+    }
+  });
+  RunTask([&]() -> Task<> {
+    co_await mutex.ReadLock();
+    read_locked = true;
+    mutex.ReadUnlock();
+  });
+  EXPECT_FALSE(read_locked);
+  event_loop.EnterLoop();
+  EXPECT_TRUE(interrupted);
+  EXPECT_TRUE(read_locked);
+  EXPECT_EQ(mutex.queued_writer_count(), 0);
+}
+
+}  // namespace
+}  // namespace coro
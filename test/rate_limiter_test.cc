@@ -0,0 +1,142 @@
+#include "coro/rate_limiter.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <vector>
+
+#include "coro/exception.h"
+#include "coro/util/event_loop.h"
+
+namespace coro {
+namespace {
+
+using ::coro::util::EventLoop;
+
+TEST(RateLimiterTest, GrantsBurstImmediately) {
+  EventLoop event_loop;
+  RateLimiter limiter(&event_loop, {.rate = 1, .burst = 5});
+  int granted = 0;
+  for (int i = 0; i < 5; i++) {
+    RunTask([&]() -> Task<> {
+      co_await limiter.Acquire();
+      granted++;
+    });
+  }
+  EXPECT_EQ(granted, 5);
+  EXPECT_FALSE(limiter.TryAcquire());
+}
+
+TEST(RateLimiterTest, PacesWaitersInOrder) {
+  EventLoop event_loop;
+  RateLimiter limiter(&event_loop, {.rate = 100, .burst = 1});
+  auto start = std::chrono::steady_clock::now();
+  std::vector<int> order;
+  for (int i = 0; i < 4; i++) {
+    RunTask([&, i]() -> Task<> {
+      co_await limiter.Acquire();
+      order.push_back(i);
+    });
+  }
+  EXPECT_EQ(order, std::vector<int>{0});
+  EXPECT_EQ(limiter.waiter_count(), 3);
+  event_loop.EnterLoop();
+  EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3}));
+  EXPECT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(30));
+}
+
+TEST(RateLimiterTest, CancelledWaiterDoesNotBlockOthers) {
+  EventLoop event_loop;
+  RateLimiter limiter(&event_loop, {.rate = 10, .burst = 10});
+  ASSERT_TRUE(limiter.TryAcquire(10));
+  stdx::stop_source stop_source;
+  bool interrupted = false;
+  bool granted = false;
+  RunTask([&]() -> Task<> {
+    try {
+      co_await limiter.Acquire(10, stop_source.get_token());
+    } catch (const InterruptedException&) {
+      interrupted = true;
+    }
+  });
+  RunTask([&]() -> Task<> {
+    co_await limiter.Acquire(1);
+    granted = true;
+  });
+  stop_source.request_stop();
+  EXPECT_TRUE(interrupted);
+  EXPECT_EQ(limiter.waiter_count(), 1);
+  event_loop.EnterLoop();
+  EXPECT_TRUE(granted);
+}
+
+TEST(RateLimiterTest, RejectsRequestsAboveBurst) {
+  EventLoop event_loop;
+  RateLimiter limiter(&event_loop, {.rate = 10, .burst = 2});
+  bool rejected = false;
+  RunTask([&]() -> Task<> {
+    try {
+      co_await limiter.Acquire(3);
+    } catch (const InvalidArgument&) {
+      rejected = true;
+    }
+  });
+  EXPECT_TRUE(rejected);
+}
+
+TEST(RateLimiterTest, RejectsNonPositiveCounts) {
+  EventLoop event_loop;
+  RateLimiter limiter(&event_loop, {.rate = 10, .burst = 2});
+  int rejected = 0;
+  for (int64_t count : {0, -1}) {
+    RunTask([&]() -> Task<> {
+      try {
+        co_await limiter.Acquire(count);
+      } catch (const InvalidArgument&) {
+        rejected++;
+      }
+    });
+    EXPECT_THROW(limiter.TryAcquire(count), InvalidArgument);
+  }
+  EXPECT_EQ(rejected, 2);
+  EXPECT_DOUBLE_EQ(limiter.available(), 2);
+}
+
+TEST(RateLimiterTest, ShardsSplitRateBetweenEventLoops) {
+  EventLoop first;
+  EventLoop second;
+  ShardedRateLimiter limiter({&first, &second}, {.rate = 10, .burst = 4});
+  EXPECT_EQ(limiter.shard(&first).config().burst, 2);
+  EXPECT_DOUBLE_EQ(limiter.shard(&second).config().rate, 5);
+  EXPECT_TRUE(limiter.shard(&first).TryAcquire(2));
+  EXPECT_FALSE(limiter.shard(&first).TryAcquire(1));
+  EXPECT_TRUE(limiter.shard(&second).TryAcquire(2));
+  EventLoop other;
+  EXPECT_THROW(limiter.shard(&other), InvalidArgument);
+}
+
+TEST(RateLimiterTest, ShardsNeedATokenEach) {
+  EventLoop first;
+  EventLoop second;
+  EventLoop third;
+  EXPECT_THROW(ShardedRateLimiter({&first, &second, &third},
+                                  {.rate = 10, .burst = 2}),
+               InvalidArgument);
+  ShardedRateLimiter limiter({&first, &second, &third},
+                             {.rate = 9, .burst = 7});
+  EXPECT_EQ(limiter.shard(&first).config().burst, 2);
+  bool rejected = false;
+  RunTask([&]() -> Task<> {
+    try {
+      // Fits into the total burst, but not into the shard's one.
+      co_await limiter.Acquire(&first, 3);
+    } catch (const InvalidArgument&) {
+      rejected = true;
+    }
+  });
+  EXPECT_TRUE(rejected);
+}
+
+}  // namespace
+}  // namespace coro
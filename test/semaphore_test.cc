@@ -0,0 +1,82 @@
+#include "coro/semaphore.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "coro/interrupted_exception.h"
+#include "coro/stdx/stop_source.h"
+
+namespace coro {
+namespace {
+
+TEST(SemaphoreTest, GrantsPermitsInFifoOrder) {
+  Semaphore semaphore(0);
+  std::string order;
+  auto acquire = [&](char name) -> Task<> {
+    co_await semaphore.Acquire();
+    order += name;
+  };
+  RunTask(acquire('a'));
+  RunTask(acquire('b'));
+  RunTask(acquire('c'));
+  EXPECT_EQ(semaphore.waiter_count(), 3);
+  semaphore.Release();
+  EXPECT_EQ(order, "a");
+  semaphore.Release(2);
+  EXPECT_EQ(order, "abc");
+  EXPECT_EQ(semaphore.available(), 0);
+}
+
+TEST(SemaphoreTest, HandsReleasedPermitToWaiterWithoutBarging) {
+  Semaphore semaphore(1);
+  EXPECT_TRUE(semaphore.TryAcquire());
+  bool acquired = false;
+  RunTask([&]() -> Task<> {
+    co_await semaphore.Acquire();
+    acquired = true;
+  });
+  EXPECT_FALSE(acquired);
+  semaphore.Release();
+  EXPECT_TRUE(acquired);
+  EXPECT_FALSE(semaphore.TryAcquire());
+  EXPECT_EQ(semaphore.available(), 0);
+}
+
+TEST(SemaphoreTest, UnlinksCancelledWaiter) {
+  Semaphore semaphore(0);
+  stdx::stop_source stop_source;
+  std::string order;
+  bool interrupted = false;
+  auto acquire = [&](char name) -> Task<> {
+    co_await semaphore.Acquire();
+    order += name;
+  };
+  RunTask(acquire('a'));
+  RunTask([&]() -> Task<> {
+    try {
+      co_await semaphore.Acquire(stop_source.get_token());
+    } catch (const InterruptedException&) {
+      interrupted = true;
+    }
+  });
+  RunTask(acquire('c'));
+  stop_source.request_stop();
+  EXPECT_TRUE(interrupted);
+  EXPECT_EQ(semaphore.waiter_count(), 2);
+  semaphore.Release(2);
+  EXPECT_EQ(order, "ac");
+  EXPECT_EQ(semaphore.available(), 0);
+}
+
+TEST(SemaphoreTest, GuardReleasesPermit) {
+  Semaphore semaphore(1);
+  RunTask([&]() -> Task<> {
+    auto guard = co_await SemaphoreGuard::Create(&semaphore);
+    EXPECT_EQ(semaphore.available(), 0);
+  });
+  EXPECT_EQ(semaphore.available(), 1);
+}
+
+}  // namespace
+}  // namespace coro
@@ -0,0 +1,74 @@
+#include "coro/shared_promise.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "coro/promise.h"
+#include "coro/util/event_loop.h"
+
+namespace coro {
+namespace {
+
+using ::coro::util::EventLoop;
+using ::coro::util::EventLoopType;
+
+Task<int> Await(Promise<int>* promise) { co_return co_await *promise; }
+
+TEST(SharedPromiseTest, CancelledWaiterLeavesOthersWaiting) {
+  EventLoop event_loop;
+  Promise<int> ready;
+  SharedPromise shared_promise([&] { return Await(&ready); });
+  stdx::stop_source stop_source;
+  std::vector<int> values;
+  bool interrupted = false;
+  RunTask([&]() -> Task<> {
+    try {
+      co_await shared_promise.Get(stop_source.get_token());
+    } catch (const InterruptedException&) {
+      interrupted = true;
+    }
+  });
+  for (int i = 0; i < 3; i++) {
+    RunTask([&]() -> Task<> {
+      values.push_back(co_await shared_promise.Get(stdx::stop_token()));
+    });
+  }
+  EXPECT_EQ(shared_promise.waiter_count(), 4);
+  stop_source.request_stop();
+  EXPECT_TRUE(interrupted);
+  EXPECT_EQ(shared_promise.waiter_count(), 3);
+  ready.SetValue(42);
+  EXPECT_EQ(shared_promise.waiter_count(), 0);
+  EXPECT_EQ(values, (std::vector<int>{42, 42, 42}));
+  event_loop.EnterLoop();
+}
+
+TEST(SharedPromiseTest, CompletesOnOtherThread) {
+  constexpr int kWaiterCount = 100;
+  EventLoop event_loop;
+  Promise<int> ready;
+  SharedPromise shared_promise([&] { return Await(&ready); });
+  std::thread::id event_loop_thread = std::this_thread::get_id();
+  std::thread producer;
+  int sum = 0;
+  int resumed_count = 0;
+  for (int i = 0; i < kWaiterCount; i++) {
+    RunTask([&]() -> Task<> {
+      sum += co_await shared_promise.Get(&event_loop, stdx::stop_token());
+      EXPECT_EQ(std::this_thread::get_id(), event_loop_thread);
+      if (++resumed_count == kWaiterCount) {
+        event_loop.ExitLoop();
+      }
+    });
+  }
+  EXPECT_EQ(shared_promise.waiter_count(), kWaiterCount);
+  producer = std::thread([&] { ready.SetValue(1); });
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  producer.join();
+  EXPECT_EQ(sum, kWaiterCount);
+}
+
+}  // namespace
+}  // namespace coro
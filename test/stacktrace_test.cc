@@ -0,0 +1,43 @@
+#include "coro/stdx/stacktrace.h"
+
+#include <gtest/gtest.h>
+
+#include "coro/exception.h"
+#include "coro/util/raii_utils.h"
+
+namespace coro {
+namespace {
+
+TEST(StacktraceTest, DisabledCaptureIsEmpty) {
+  auto guard = util::AtScopeExit(
+      [rate = GetStacktraceSampleRate()] { SetStacktraceSampleRate(rate); });
+  SetStacktraceSampleRate(0);
+  uint64_t capture_count = GetStacktraceCaptureCount();
+  RuntimeError error("error");
+  EXPECT_TRUE(error.stacktrace().empty());
+  EXPECT_EQ(ToString(error.stacktrace()), "");
+  EXPECT_EQ(GetStacktraceCaptureCount(), capture_count);
+}
+
+TEST(StacktraceTest, SamplesCaptures) {
+  auto guard = util::AtScopeExit(
+      [rate = GetStacktraceSampleRate()] { SetStacktraceSampleRate(rate); });
+  SetStacktraceSampleRate(1);
+  if (stdx::stacktrace::current().empty()) {
+    GTEST_SKIP() << "capturing stack traces is unsupported";
+  }
+  SetStacktraceSampleRate(4);
+  uint64_t capture_count = GetStacktraceCaptureCount();
+  int non_empty_count = 0;
+  for (int i = 0; i < 8; i++) {
+    stdx::stacktrace stacktrace = stdx::stacktrace::current();
+    stdx::stacktrace copy = stacktrace;
+    EXPECT_EQ(copy.empty(), stacktrace.empty());
+    non_empty_count += stacktrace.empty() ? 0 : 1;
+  }
+  EXPECT_EQ(GetStacktraceCaptureCount() - capture_count, non_empty_count);
+  EXPECT_EQ(non_empty_count, 2);
+}
+
+}  // namespace
+}  // namespace coro
@@ -0,0 +1,95 @@
+#include "coro/stdx/stop_source.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "coro/stdx/stop_callback.h"
+
+namespace coro::stdx {
+namespace {
+
+TEST(StopSourceTest, InvokesRegisteredCallbacksOnce) {
+  stop_source stop_source;
+  int call_count = 0;
+  stop_callback cb1(stop_source.get_token(), [&] { call_count++; });
+  stop_callback cb2(stop_source.get_token(), [&] { call_count++; });
+  EXPECT_TRUE(stop_source.request_stop());
+  EXPECT_FALSE(stop_source.request_stop());
+  EXPECT_EQ(call_count, 2);
+  EXPECT_TRUE(stop_source.get_token().stop_requested());
+}
+
+TEST(StopSourceTest, InvokesCallbackRegisteredAfterStopImmediately) {
+  stop_source stop_source;
+  stop_source.request_stop();
+  bool called = false;
+  stop_callback cb(stop_source.get_token(), [&] { called = true; });
+  EXPECT_TRUE(called);
+}
+
+TEST(StopSourceTest, DoesNotInvokeDeregisteredCallback) {
+  stop_source stop_source;
+  bool called = false;
+  {
+    stop_callback cb(stop_source.get_token(), [&] { called = true; });
+  }
+  stop_source.request_stop();
+  EXPECT_FALSE(called);
+}
+
+TEST(StopSourceTest, CallbackCanDestroyItself) {
+  stop_source stop_source;
+  struct DestroySelf {
+    void operator()() const { cb->reset(); }
+    std::optional<stop_callback<DestroySelf>>* cb;
+  };
+  std::optional<stop_callback<DestroySelf>> cb;
+  cb.emplace(stop_source.get_token(), DestroySelf{&cb});
+  stop_source.request_stop();
+  EXPECT_FALSE(cb);
+}
+
+TEST(StopSourceTest, RegistersCallbacksConcurrentlyWithStop) {
+  constexpr int kThreadCount = 4;
+  constexpr int kIterationCount = 1000;
+  for (int i = 0; i < 20; i++) {
+    stop_source stop_source;
+    std::atomic<int> call_count = 0;
+    std::atomic<int> registered_count = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreadCount; t++) {
+      threads.emplace_back([&] {
+        for (int j = 0; j < kIterationCount; j++) {
+          std::atomic<bool> called = false;
+          {
+            stop_callback cb(stop_source.get_token(), [&] {
+              called = true;
+              call_count++;
+            });
+            registered_count++;
+          }
+          // Once the callback got deregistered, it must not run anymore.
+          bool was_called = called;
+          std::this_thread::yield();
+          EXPECT_EQ(was_called, called.load());
+        }
+      });
+    }
+    while (registered_count < kThreadCount * kIterationCount / 2) {
+      std::this_thread::yield();
+    }
+    stop_source.request_stop();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    EXPECT_TRUE(stop_source.get_token().stop_requested());
+  }
+}
+
+}  // namespace
+}  // namespace coro::stdx
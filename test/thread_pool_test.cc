@@ -0,0 +1,396 @@
+#include "coro/util/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "coro/exception.h"
+#include "coro/when_all.h"
+
+namespace coro::util {
+namespace {
+
+TEST(ThreadPoolTest, RunsJobsOnWorkerThreads) {
+  EventLoop event_loop;
+  ThreadPool thread_pool(&event_loop, 2);
+  std::thread::id event_loop_thread = std::this_thread::get_id();
+  std::thread::id worker_thread;
+  std::thread::id resumed_thread;
+  RunTask([&]() -> Task<> {
+    worker_thread =
+        co_await thread_pool.Do([] { return std::this_thread::get_id(); });
+    resumed_thread = std::this_thread::get_id();
+    event_loop.ExitLoop();
+  });
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  EXPECT_NE(worker_thread, event_loop_thread);
+  EXPECT_EQ(resumed_thread, event_loop_thread);
+}
+
+TEST(ThreadPoolTest, PropagatesExceptions) {
+  EventLoop event_loop;
+  ThreadPool thread_pool(&event_loop, 1);
+  std::string message;
+  RunTask([&]() -> Task<> {
+    try {
+      co_await thread_pool.Do([] { throw RuntimeError("job failed"); });
+    } catch (const RuntimeError& e) {
+      message = e.what();
+    }
+    event_loop.ExitLoop();
+  });
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  EXPECT_EQ(message, "job failed");
+}
+
+TEST(ThreadPoolTest, ComposesLikeTask) {
+  EventLoop event_loop;
+  ThreadPool thread_pool(&event_loop, 2);
+  auto to_task = [&](int value) -> Task<int> {
+    return thread_pool.Do([value] { return value; });
+  };
+  std::tuple<int, int> pair;
+  std::vector<int> values;
+  bool ran = false;
+  RunTask(thread_pool.Do([&] { ran = true; }));
+  RunTask([&]() -> Task<> {
+    pair = co_await WhenAll(thread_pool.Do([] { return 1; }), to_task(2));
+    std::vector<Task<int>> tasks;
+    for (int i = 0; i < 3; i++) {
+      tasks.push_back(thread_pool.Do([i] { return i; }));
+    }
+    values = co_await WhenAll(std::move(tasks));
+  });
+  event_loop.EnterLoop();
+  EXPECT_TRUE(ran);
+  EXPECT_EQ(pair, std::make_tuple(1, 2));
+  EXPECT_EQ(values, (std::vector<int>{0, 1, 2}));
+}
+
+TEST(ThreadPoolTest, RunsJobsInSubmissionOrder) {
+  constexpr int kJobCount = 100;
+  EventLoop event_loop;
+  ThreadPool thread_pool(&event_loop, 1);
+  std::atomic<bool> released = false;
+  std::vector<int> order;
+  int done_count = 0;
+  auto on_done = [&] {
+    if (++done_count == kJobCount + 1) {
+      event_loop.ExitLoop();
+    }
+  };
+  RunTask([&]() -> Task<> {
+    // Keeps the only worker busy until all the other jobs got queued.
+    co_await thread_pool.Do([&released] { released.wait(false); });
+    on_done();
+  });
+  for (int i = 0; i < kJobCount; i++) {
+    RunTask([&, i]() -> Task<> {
+      co_await thread_pool.Do([&order, i] { order.push_back(i); });
+      on_done();
+    });
+  }
+  released = true;
+  released.notify_all();
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  ASSERT_EQ(order.size(), kJobCount);
+  for (int i = 0; i < kJobCount; i++) {
+    EXPECT_EQ(order[i], i);
+  }
+}
+
+TEST(ThreadPoolTest, CancelsQueuedJob) {
+  EventLoop event_loop;
+  ThreadPool thread_pool(&event_loop, 1);
+  std::atomic<bool> released = false;
+  stdx::stop_source stop_source;
+  bool ran = false;
+  bool interrupted = false;
+  RunTask([&]() -> Task<> {
+    co_await thread_pool.Do([&released] { released.wait(false); });
+    event_loop.ExitLoop();
+  });
+  RunTask([&]() -> Task<> {
+    auto result = co_await thread_pool.DoExpected(stop_source.get_token(),
+                                                  [&] { ran = true; });
+    interrupted = !result && result.error().interrupted();
+    released = true;
+    released.notify_all();
+  });
+  stop_source.request_stop();
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  EXPECT_TRUE(interrupted);
+  EXPECT_FALSE(ran);
+}
+
+TEST(ThreadPoolTest, ResumesJobCancelledFromOtherThreadOnEventLoop) {
+  EventLoop event_loop;
+  ThreadPool thread_pool(&event_loop, 1);
+  std::atomic<bool> released = false;
+  stdx::stop_source stop_source;
+  std::thread::id event_loop_thread = std::this_thread::get_id();
+  std::thread::id resumed_thread;
+  bool interrupted = false;
+  RunTask([&]() -> Task<> {
+    co_await thread_pool.Do([&released] { released.wait(false); });
+  });
+  RunTask([&]() -> Task<> {
+    auto result =
+        co_await thread_pool.DoExpected(stop_source.get_token(), [] {});
+    resumed_thread = std::this_thread::get_id();
+    interrupted = !result && result.error().interrupted();
+    released = true;
+    released.notify_all();
+  });
+  std::thread thread([&] { stop_source.request_stop(); });
+  event_loop.EnterLoop();
+  thread.join();
+  EXPECT_TRUE(interrupted);
+  EXPECT_EQ(resumed_thread, event_loop_thread);
+}
+
+TEST(ThreadPoolTest, RunsManyJobsConcurrently) {
+  constexpr int kJobCount = 5000;
+  EventLoop event_loop;
+  ThreadPool thread_pool(&event_loop, 4);
+  std::vector<int> results(kJobCount);
+  int done_count = 0;
+  for (int i = 0; i < kJobCount; i++) {
+    RunTask([&, i]() -> Task<> {
+      results[i] = co_await thread_pool.Do([i] { return 2 * i; });
+      if (++done_count == kJobCount) {
+        event_loop.ExitLoop();
+      }
+    });
+  }
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  for (int i = 0; i < kJobCount; i++) {
+    EXPECT_EQ(results[i], 2 * i);
+  }
+}
+
+TEST(ThreadPoolTest, KeepsEventLoopAliveWhileJobsRun) {
+  EventLoop event_loop;
+  ThreadPool thread_pool(&event_loop, 1);
+  int result = 0;
+  RunTask([&]() -> Task<> {
+    result = co_await thread_pool.Do([] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      return 42;
+    });
+  });
+  event_loop.EnterLoop();
+  EXPECT_EQ(result, 42);
+}
+
+TEST(ThreadPoolTest, ResumesCompletionsInBatches) {
+  constexpr int kJobCount = 64;
+  EventLoop event_loop;
+  ThreadPool thread_pool(&event_loop, 4);
+  std::atomic<int> finished_count = 0;
+  int done_count = 0;
+  for (int i = 0; i < kJobCount; i++) {
+    RunTask([&]() -> Task<> {
+      co_await thread_pool.Do([&] { finished_count++; });
+      done_count++;
+    });
+  }
+  // All the jobs finish before the event loop gets to run.
+  while (finished_count < kJobCount) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  event_loop.EnterLoop();
+  EXPECT_EQ(done_count, kJobCount);
+  ThreadPool::CompletionStats stats = thread_pool.completion_stats();
+  EXPECT_EQ(stats.completion_count, kJobCount);
+  EXPECT_EQ(std::accumulate(stats.batch_count.begin(),
+                            stats.batch_count.end(), uint64_t{0}),
+            1);
+  EXPECT_EQ(stats.batch_count[6], 1);
+}
+
+TEST(ThreadPoolTest, RunsLatencySensitiveJobsBeforeBulkOnes) {
+  constexpr int kBulkJobCount = 10;
+  EventLoop event_loop;
+  ThreadPool thread_pool(&event_loop, 1);
+  std::atomic<bool> released = false;
+  std::vector<std::string> order;
+  int done_count = 0;
+  auto on_done = [&] {
+    if (++done_count == kBulkJobCount + 2) {
+      event_loop.ExitLoop();
+    }
+  };
+  RunTask([&]() -> Task<> {
+    co_await thread_pool.Do([&released] { released.wait(false); });
+    on_done();
+  });
+  for (int i = 0; i < kBulkJobCount; i++) {
+    RunTask([&]() -> Task<> {
+      co_await thread_pool.Do(ThreadPool::Priority::kBulk,
+                              [&order] { order.push_back("bulk"); });
+      on_done();
+    });
+  }
+  RunTask([&]() -> Task<> {
+    co_await thread_pool.Do(ThreadPool::Priority::kLatencySensitive,
+                            [&order] { order.push_back("latency"); });
+    on_done();
+  });
+  released = true;
+  released.notify_all();
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  ASSERT_EQ(order.size(), kBulkJobCount + 1);
+  EXPECT_EQ(order[0], "latency");
+}
+
+TEST(ThreadPoolTest, LimitsPendingJobs) {
+  constexpr int kJobCount = 8;
+  EventLoop event_loop;
+  ThreadPool thread_pool(&event_loop, {.min_thread_count = 4,
+                                       .max_thread_count = 4,
+                                       .max_pending_job_count = 2});
+  std::atomic<int> running_count = 0;
+  std::atomic<int> max_running_count = 0;
+  int done_count = 0;
+  for (int i = 0; i < kJobCount; i++) {
+    RunTask([&]() -> Task<> {
+      co_await thread_pool.Do(ThreadPool::Priority::kBulk, [&] {
+        int count = ++running_count;
+        int max_count = max_running_count;
+        while (count > max_count &&
+               !max_running_count.compare_exchange_weak(max_count, count)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        running_count--;
+      });
+      if (++done_count == kJobCount) {
+        event_loop.ExitLoop();
+      }
+    });
+  }
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  EXPECT_EQ(done_count, kJobCount);
+  EXPECT_LE(max_running_count, 2);
+}
+
+TEST(ThreadPoolTest, CancelsJobWaitingForAdmission) {
+  EventLoop event_loop;
+  ThreadPool thread_pool(&event_loop, {.min_thread_count = 1,
+                                       .max_thread_count = 1,
+                                       .max_pending_job_count = 1});
+  std::atomic<bool> released = false;
+  stdx::stop_source stop_source;
+  bool ran = false;
+  bool interrupted = false;
+  RunTask([&]() -> Task<> {
+    co_await thread_pool.Do([&released] { released.wait(false); });
+    event_loop.ExitLoop();
+  });
+  RunTask([&]() -> Task<> {
+    auto result = co_await thread_pool.DoExpected(stop_source.get_token(),
+                                                  [&] { ran = true; });
+    interrupted = !result && result.error().interrupted();
+  });
+  stop_source.request_stop();
+  released = true;
+  released.notify_all();
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  EXPECT_TRUE(interrupted);
+  EXPECT_FALSE(ran);
+}
+
+TEST(ThreadPoolTest, GrowsWhileBusyAndShrinksWhenIdle) {
+  constexpr int kJobCount = 4;
+  EventLoop event_loop;
+  ThreadPool thread_pool(&event_loop,
+                         {.min_thread_count = 1,
+                          .max_thread_count = kJobCount,
+                          .idle_timeout = std::chrono::milliseconds(50)});
+  EXPECT_EQ(thread_pool.thread_count(), 1);
+  std::atomic<int> running_count = 0;
+  int done_count = 0;
+  for (int i = 0; i < kJobCount; i++) {
+    RunTask([&]() -> Task<> {
+      // Finishes only once all the jobs run at the same time.
+      co_await thread_pool.Do([&running_count] {
+        running_count++;
+        while (running_count < kJobCount) {
+          std::this_thread::yield();
+        }
+      });
+      if (++done_count == kJobCount) {
+        event_loop.ExitLoop();
+      }
+    });
+  }
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  EXPECT_EQ(thread_pool.thread_count(), kJobCount);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (thread_pool.thread_count() > 1 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(thread_pool.thread_count(), 1);
+}
+
+TEST(ThreadPoolTest, SchedulesCoroutinesOntoWorkers) {
+  EventLoop event_loop;
+  ThreadPool thread_pool(&event_loop, 1);
+  std::thread::id event_loop_thread = std::this_thread::get_id();
+  std::thread::id worker_thread;
+  std::thread::id resumed_thread;
+  RunTask([&]() -> Task<> {
+    co_await thread_pool.Schedule(ThreadPool::Priority::kBulk);
+    worker_thread = std::this_thread::get_id();
+    co_await event_loop.Schedule();
+    resumed_thread = std::this_thread::get_id();
+    event_loop.ExitLoop();
+  });
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  EXPECT_NE(worker_thread, event_loop_thread);
+  EXPECT_EQ(resumed_thread, event_loop_thread);
+}
+
+TEST(ThreadPoolTest, RunsCoroutinesScheduledByWorkers) {
+  constexpr int kCoroutineCount = 100;
+  EventLoop event_loop;
+  // A single worker, so that nothing drains the injection queue meanwhile.
+  ThreadPool thread_pool(&event_loop,
+                         {.min_thread_count = 1, .max_thread_count = 1});
+  std::thread::id event_loop_thread = std::this_thread::get_id();
+  std::atomic<int> done_count = 0;
+  std::atomic<int> off_worker_count = 0;
+  size_t injected_count = 0;
+  RunTask([&]() -> Task<> {
+    co_await thread_pool.Schedule();
+    // Each of these lands on the queue of the worker running this loop.
+    for (int i = 0; i < kCoroutineCount; i++) {
+      RunTask([&]() -> Task<> {
+        co_await thread_pool.Schedule();
+        if (std::this_thread::get_id() == event_loop_thread) {
+          off_worker_count++;
+        }
+        if (++done_count == kCoroutineCount) {
+          event_loop.ExitLoop();
+        }
+      });
+    }
+    injected_count = thread_pool.injected_count(
+        ThreadPool::Priority::kLatencySensitive);
+  });
+  event_loop.EnterLoop(EventLoopType::NoExitOnEmpty);
+  EXPECT_EQ(done_count, kCoroutineCount);
+  EXPECT_EQ(off_worker_count, 0);
+  EXPECT_EQ(injected_count, 0);
+}
+
+}  // namespace
+}  // namespace coro::util
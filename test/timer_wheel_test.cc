@@ -0,0 +1,79 @@
+#include "coro/util/timer_wheel.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace coro::util {
+namespace {
+
+class TestTimer : public TimerWheel::Timer {
+ public:
+  explicit TestTimer(std::vector<uint64_t>* expired) : expired_(expired) {}
+
+  const TimerWheel* wheel = nullptr;
+
+ protected:
+  void OnExpired() override { expired_->push_back(wheel->now()); }
+
+ private:
+  std::vector<uint64_t>* expired_;
+};
+
+TEST(TimerWheelTest, ExpiresTimersInOrderAtTheirTick) {
+  std::mt19937 random(0);
+  TimerWheel wheel(1000);
+  std::vector<uint64_t> expired;
+  std::vector<std::unique_ptr<TestTimer>> timers;
+  std::vector<uint64_t> expiries;
+  for (int i = 0; i < 1000; i++) {
+    uint64_t expiry = 1000 + random() % (1 << (i % 20 + 1));
+    auto timer = std::make_unique<TestTimer>(&expired);
+    timer->wheel = &wheel;
+    wheel.Add(timer.get(), expiry);
+    timers.push_back(std::move(timer));
+    expiries.push_back(expiry);
+  }
+  EXPECT_EQ(wheel.size(), 1000);
+  uint64_t now = 1000;
+  while (!wheel.empty()) {
+    now += random() % 5000;
+    wheel.Advance(now);
+  }
+  std::sort(expiries.begin(), expiries.end());
+  EXPECT_EQ(expired, expiries);
+}
+
+TEST(TimerWheelTest, AdvancesToExactExpiry) {
+  TimerWheel wheel;
+  std::vector<uint64_t> expired;
+  TestTimer timer1(&expired), timer2(&expired), timer3(&expired);
+  timer1.wheel = timer2.wheel = timer3.wheel = &wheel;
+  wheel.Add(&timer1, 70);
+  wheel.Add(&timer2, 5000);
+  wheel.Add(&timer3, 300000);
+  EXPECT_EQ(wheel.NextTick(), 64);
+  wheel.Advance(1000000);
+  EXPECT_EQ(expired, (std::vector<uint64_t>{70, 5000, 300000}));
+  EXPECT_EQ(wheel.NextTick(), std::nullopt);
+}
+
+TEST(TimerWheelTest, RemovedTimerDoesNotExpire) {
+  TimerWheel wheel;
+  std::vector<uint64_t> expired;
+  TestTimer timer1(&expired), timer2(&expired);
+  timer1.wheel = timer2.wheel = &wheel;
+  wheel.Add(&timer1, 10);
+  wheel.Add(&timer2, 10);
+  wheel.Remove(&timer1);
+  EXPECT_FALSE(timer1.linked());
+  wheel.Advance(10);
+  EXPECT_EQ(expired, (std::vector<uint64_t>{10}));
+  EXPECT_TRUE(wheel.empty());
+}
+
+}  // namespace
+}  // namespace coro::util
@@ -0,0 +1,116 @@
+#include "coro/when_all.h"
+
+#include <gtest/gtest.h>
+
+#include "coro/util/event_loop.h"
+#include "coro/when_any.h"
+
+namespace coro {
+namespace {
+
+using ::coro::util::EventLoop;
+
+template <typename F>
+void RunLoop(EventLoop& event_loop, F func) {
+  std::exception_ptr exception;
+  RunTask([&]() -> Task<> {
+    try {
+      co_await func();
+    } catch (...) {
+      exception = std::current_exception();
+    }
+  });
+  event_loop.EnterLoop();
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+TEST(WhenAnyTest, ReturnsFirstResultAndCancelsOthers) {
+  EventLoop event_loop;
+  bool interrupted = false;
+  std::optional<std::variant<int, std::string>> result;
+  RunLoop(event_loop, [&]() -> Task<> {
+    result = co_await WhenAny(
+        stdx::stop_token(),
+        [&](stdx::stop_token stop_token) -> Task<int> {
+          co_await event_loop.Wait(10, std::move(stop_token));
+          co_return 42;
+        },
+        [&](stdx::stop_token stop_token) -> Task<std::string> {
+          try {
+            co_await event_loop.Wait(10000, std::move(stop_token));
+          } catch (const InterruptedException&) {
+            interrupted = true;
+            throw;
+          }
+          co_return "slow";
+        });
+  });
+  ASSERT_TRUE(result);
+  EXPECT_EQ(result->index(), 0);
+  EXPECT_EQ(std::get<0>(*result), 42);
+  EXPECT_TRUE(interrupted);
+}
+
+TEST(WhenAnyTest, RethrowsWhenEveryTaskFails) {
+  EventLoop event_loop;
+  auto when_any = [&]() -> Task<> {
+    co_await WhenAny(
+        stdx::stop_token(),
+        [](stdx::stop_token) -> Task<> {
+          throw RuntimeError("first");
+          co_return;
+        },
+        [](stdx::stop_token) -> Task<int> {
+          throw RuntimeError("second");
+          co_return 0;
+        });
+  };
+  EXPECT_THROW(RunLoop(event_loop, when_any), RuntimeError);
+}
+
+TEST(WhenAllFailFastTest, ReturnsAllResults) {
+  EventLoop event_loop;
+  std::optional<std::tuple<int, std::monostate>> result;
+  RunLoop(event_loop, [&]() -> Task<> {
+    result = co_await WhenAllFailFast(
+        stdx::stop_token(),
+        [&](stdx::stop_token stop_token) -> Task<int> {
+          co_await event_loop.Wait(10, std::move(stop_token));
+          co_return 1;
+        },
+        [&](stdx::stop_token stop_token) -> Task<> {
+          co_await event_loop.Wait(5, std::move(stop_token));
+        });
+  });
+  ASSERT_TRUE(result);
+  EXPECT_EQ(std::get<0>(*result), 1);
+}
+
+TEST(WhenAllFailFastTest, CancelsSiblingsOnFailure) {
+  EventLoop event_loop;
+  bool interrupted = false;
+  auto when_all = [&]() -> Task<> {
+    co_await WhenAllFailFast(
+        stdx::stop_token(),
+        [&](stdx::stop_token stop_token) -> Task<> {
+          co_await event_loop.Wait(10, std::move(stop_token));
+          throw RuntimeError("failed");
+        },
+        [&](stdx::stop_token stop_token) -> Task<int> {
+          try {
+            co_await event_loop.Wait(10000, std::move(stop_token));
+          } catch (const InterruptedException&) {
+            interrupted = true;
+            throw;
+          }
+          co_return 0;
+        });
+  };
+  EXPECT_THROW(RunLoop(event_loop, when_all), RuntimeError);
+  EXPECT_TRUE(interrupted);
+}
+
+}  // namespace
+}  // namespace coro